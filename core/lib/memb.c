@@ -47,57 +47,109 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+#ifdef MEMB_CONF_CHECK_DOUBLE_FREE
+#define MEMB_CHECK_DOUBLE_FREE MEMB_CONF_CHECK_DOUBLE_FREE
+#else /* MEMB_CONF_CHECK_DOUBLE_FREE */
+#define MEMB_CHECK_DOUBLE_FREE 0
+#endif /* MEMB_CONF_CHECK_DOUBLE_FREE */
+
+#if MEMB_CHECK_DOUBLE_FREE
+#include <stdio.h>
+#endif /* MEMB_CHECK_DOUBLE_FREE */
+
+/*---------------------------------------------------------------------------*/
+/* The free stack holds one byte per index in pools of up to 256
+   blocks, and two bytes, low byte first, in larger pools. */
+static unsigned short
+free_pop(struct memb *m)
+{
+  unsigned short n = --m->nfree;
+
+  if(m->num > 256) {
+    return m->free[2 * n] | (m->free[2 * n + 1] << 8);
+  }
+  return m->free[n];
+}
+/*---------------------------------------------------------------------------*/
+static void
+free_push(struct memb *m, unsigned short i)
+{
+  unsigned short n = m->nfree++;
+
+  if(m->num > 256) {
+    m->free[2 * n] = i & 0xff;
+    m->free[2 * n + 1] = i >> 8;
+  } else {
+    m->free[n] = i;
+  }
+}
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
 {
   memset(m->count, 0, m->num);
   memset(m->mem, 0, m->size * m->num);
+  m->nfree = 0;
+  m->unused = 0;
 }
 /*---------------------------------------------------------------------------*/
 void *
 memb_alloc(struct memb *m)
 {
-  int i;
+  unsigned short i;
 
-  for(i = 0; i < m->num; ++i) {
-    if(m->count[i] == 0) {
-      /* If this block was unused, we increase the reference count to
-	 indicate that it now is used and return a pointer to the
-	 memory block. */
-      ++(m->count[i]);
-      return (void *)((char *)m->mem + (i * m->size));
-    }
+  if(m->nfree > 0) {
+    /* Reuse the most recently freed block. */
+    i = free_pop(m);
+  } else if(m->unused < m->num) {
+    /* Hand out the next block that has never been used. */
+    i = m->unused++;
+  } else {
+    /* No free block was found, so we return NULL to indicate failure
+       to allocate block. */
+    return NULL;
   }
 
-  /* No free block was found, so we return NULL to indicate failure to
-     allocate block. */
-  return NULL;
+  /* Increase the reference count to indicate that the block now is
+     used and return a pointer to the memory block. */
+  ++(m->count[i]);
+  return (void *)((char *)m->mem + (i * m->size));
 }
 /*---------------------------------------------------------------------------*/
 char
 memb_free(struct memb *m, void *ptr)
 {
-  int i;
-  char *ptr2;
+  unsigned short i;
+  unsigned long offset;
+
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+
+  /* Find the block to which "ptr" points from its offset. */
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+#if MEMB_CHECK_DOUBLE_FREE
+    printf("memb: free of %p, not the start of a block\n", ptr);
+#endif /* MEMB_CHECK_DOUBLE_FREE */
+    return -1;
+  }
+  i = offset / m->size;
 
-  /* Walk through the list of blocks and try to find the block to
-     which the pointer "ptr" points to. */
-  ptr2 = (char *)m->mem;
-  for(i = 0; i < m->num; ++i) {
-    
-    if(ptr2 == (char *)ptr) {
-      /* We've found to block to which "ptr" points so we decrease the
-	 reference count and return the new value of it. */
-      if(m->count[i] > 0) {
-	/* Make sure that we don't deallocate free memory. */
-	--(m->count[i]);
-      }
-      return m->count[i];
-    }
-    ptr2 += m->size;
+  /* Make sure that we don't deallocate free memory. */
+  if(m->count[i] == 0) {
+#if MEMB_CHECK_DOUBLE_FREE
+    printf("memb: double free of %p (block %u)\n", ptr, i);
+#endif /* MEMB_CHECK_DOUBLE_FREE */
+    return 0;
   }
-  return -1;
+
+  /* Decrease the reference count and put the block back on the free
+     stack once the last reference is gone. */
+  if(--(m->count[i]) == 0) {
+    free_push(m, i);
+  }
+  return m->count[i];
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -110,15 +162,6 @@ memb_inmemb(struct memb *m, void *ptr)
 int
 memb_numfree(struct memb *m)
 {
-  int i;
-  int num_free = 0;
-
-  for(i = 0; i < m->num; ++i) {
-    if(m->count[i] == 0) {
-      ++num_free;
-    }
-  }
-
-  return num_free;
+  return m->nfree + (m->num - m->unused);
 }
 /** @} */
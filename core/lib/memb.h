@@ -88,16 +88,38 @@ MEMB(connections, struct connection, 16);
  */
 #define MEMB(name, structure, num) \
         static char CC_CONCAT(name,_memb_count)[num]; \
+        static unsigned char CC_CONCAT(name,_memb_free)[MEMB_FREE_SIZE(num)]; \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_count), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                          (void *)CC_CONCAT(name,_memb_mem), \
+                                          CC_CONCAT(name,_memb_free), 0, 0}
 
+/* Bytes of free stack for a pool of num blocks: one per block index
+   for pools of up to 256 blocks, two for larger pools */
+#define MEMB_FREE_SIZE(num) ((num) > 256 ? 2 * (num) : (num))
+
+/*
+ * Free blocks are kept on a stack of block indices (free) so that
+ * memb_alloc() and memb_free() run in constant time. Blocks that
+ * have never been handed out are not on the stack: they are taken in
+ * order from the "unused" watermark instead. A zero-initialized
+ * struct memb is therefore a valid, empty pool, which keeps pools
+ * that are never passed to memb_init() working.
+ *
+ * The links are kept outside the blocks on purpose: many callers
+ * still use a block after freeing it, e.g. memb_free() before
+ * list_remove(), and a link threaded through the block would clobber
+ * its first field.
+ */
 struct memb {
   unsigned short size;
   unsigned short num;
   char *count;
   void *mem;
+  unsigned char *free;
+  unsigned short nfree;
+  unsigned short unused;
 };
 
 /**
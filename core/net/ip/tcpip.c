@@ -828,6 +828,10 @@ PROCESS_THREAD(tcpip_process, ev, data)
  }
 #endif
 
+  /* Timer and poll events for the stack should not wait behind
+     application events. */
+  tcpip_process.priority = PROCESS_PRIORITY_HIGH;
+
   tcpip_event = process_alloc_event();
 #if UIP_CONF_ICMP6
   tcpip_icmp6_event = process_alloc_event();
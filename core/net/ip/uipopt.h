@@ -591,6 +591,43 @@ void uip_log(char *msg);
 #define SICSLOWPAN_CONF_FRAG  0
 #endif
 
+/**
+ * How many fragmented packets can be reassembled at the same time.
+ * Each context holds a full uIP buffer.
+ */
+#ifndef SICSLOWPAN_CONF_REASS_CONTEXTS
+#define SICSLOWPAN_CONF_REASS_CONTEXTS 1
+#endif
+
+/**
+ * Forward fragments hop by hop instead of reassembling the packet at
+ * every router. The route is looked up from the headers in the first
+ * fragment and the following fragments are relayed as they arrive.
+ * The RPL hop-by-hop option in the first fragment is checked and
+ * updated as for a reassembled packet. Otherwise the IP layer of the
+ * router does not see these packets.
+ */
+#ifndef SICSLOWPAN_CONF_FRAG_FORWARDING
+#define SICSLOWPAN_CONF_FRAG_FORWARDING 0
+#endif
+
+/**
+ * How many fragmented packets can be forwarded at the same time.
+ */
+#ifndef SICSLOWPAN_CONF_FRAG_FORWARD_ENTRIES
+#define SICSLOWPAN_CONF_FRAG_FORWARD_ENTRIES 4
+#endif
+
+/**
+ * Support the compressed encoding of the RPL hop-by-hop option (RPI
+ * 6LoRH, RFC 8138) with IPHC. Received packets are always accepted
+ * in that form; it is only used to send when the DODAG advertises it
+ * in its DIO configuration option.
+ */
+#ifndef SICSLOWPAN_CONF_COMPRESS_RPI
+#define SICSLOWPAN_CONF_COMPRESS_RPI 1
+#endif
+
 /** @} */
 
 /*------------------------------------------------------------------------------*/
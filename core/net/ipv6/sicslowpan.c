@@ -68,6 +68,11 @@
 #include "net/rime/rime.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/netstack.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#if UIP_CONF_IPV6_RPL
+#include "net/rpl/rpl.h"
+#endif /* UIP_CONF_IPV6_RPL */
 
 #include <stdio.h>
 
@@ -112,6 +117,23 @@ void uip_log(char *msg);
 #endif /* SICSLOWPAN_CONF_COMPRESSION */
 #endif /* SICSLOWPAN_COMPRESSION */
 
+/* The RPI 6LoRH comes with IPHC and is only meaningful with RPL */
+#if SICSLOWPAN_CONF_COMPRESS_RPI && UIP_CONF_IPV6_RPL && \
+  SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+#define SICSLOWPAN_COMPRESS_RPI 1
+#else
+#define SICSLOWPAN_COMPRESS_RPI 0
+#endif
+
+/* SICSLOWPAN_CONF_ANYCAST_ADDR(dest, nexthop, addr), e.g.
+   rpl_anycast_addr, may put a link-layer anycast address that stands
+   for nexthop and its alternatives into addr. It returns non-zero if it
+   did, and the packet to dest is then sent to that address. */
+#ifdef SICSLOWPAN_CONF_ANYCAST_ADDR
+int SICSLOWPAN_CONF_ANYCAST_ADDR(const uip_ipaddr_t *dest,
+                                 const linkaddr_t *nexthop, linkaddr_t *addr);
+#endif /* SICSLOWPAN_CONF_ANYCAST_ADDR */
+
 #define GET16(ptr,index) (((uint16_t)((ptr)[index] << 8)) | ((ptr)[(index) + 1]))
 #define SET16(ptr,index,value) do {     \
   (ptr)[index] = ((value) >> 8) & 0xff; \
@@ -221,35 +243,70 @@ static int last_tx_status;
  *  @{
  */
 
+/** The total length of the IPv6 packet in the sicslowpan_buf. */
 static uint16_t sicslowpan_len;
 
 /**
- * The buffer used for the 6lowpan reassembly.
- * This buffer contains only the IPv6 packet (no MAC header, 6lowpan, etc).
- * It has a fix size as we do not use dynamic memory allocation.
+ * A packet being reassembled. Fragments are matched to a context by
+ * sender, datagram tag and datagram size, so fragments from several
+ * senders can be merged at the same time.
  */
-static uip_buf_t sicslowpan_aligned_buf;
-#define sicslowpan_buf (sicslowpan_aligned_buf.u8)
+struct reass_context {
+  struct reass_context *next;
+  /** The buffer holding the IPv6 packet (no MAC header, 6lowpan, etc). */
+  uip_buf_t buf;
+  /** The total length of the IPv6 packet. */
+  uint16_t len;
+  /**
+   * length of the ip packet already received.
+   * It includes IP and transport headers.
+   */
+  uint16_t processed;
+  /** The tag in the fragments being merged. */
+  uint16_t tag;
+  /** The source address of the fragments being merged */
+  linkaddr_t sender;
+  /** Reassembly %process %timer. */
+  struct timer timer;
+};
 
-/** The total length of the IPv6 packet in the sicslowpan_buf. */
+MEMB(reass_memb, struct reass_context, SICSLOWPAN_CONF_REASS_CONTEXTS);
+/** Contexts in use, most recently used first. */
+LIST(reass_list);
 
 /**
- * length of the ip packet already sent / received.
- * It includes IP and transport headers.
+ * The buffer the packet being received is decompressed into: the
+ * buffer of its reassembly context, or uip_buf if it is not
+ * fragmented.
  */
-static uint16_t processed_ip_in_len;
+static uint8_t *sicslowpan_buf;
 
 /** Datagram tag to be put in the fragments I send. */
 static uint16_t my_tag;
 
-/** When reassembling, the tag in the fragments being merged. */
-static uint16_t reass_tag;
-
-/** When reassembling, the source address of the fragments being merged */
-linkaddr_t frag_sender;
+#if SICSLOWPAN_CONF_FRAG_FORWARDING
+/**
+ * A fragmented packet being forwarded without reassembly. The
+ * following fragments from sender with in_tag are sent to nexthop
+ * with out_tag.
+ */
+struct frag_forward {
+  struct frag_forward *next;
+  linkaddr_t sender;
+  linkaddr_t nexthop;
+  uint16_t in_tag;
+  uint16_t out_tag;
+  /** The total length of the IPv6 packet. */
+  uint16_t size;
+  /** Length of the IPv6 packet already forwarded. */
+  uint16_t processed;
+  struct timer timer;
+};
 
-/** Reassembly %process %timer. */
-static struct timer reass_timer;
+MEMB(frag_forward_memb, struct frag_forward,
+     SICSLOWPAN_CONF_FRAG_FORWARD_ENTRIES);
+LIST(frag_forward_list);
+#endif /* SICSLOWPAN_CONF_FRAG_FORWARDING */
 
 /** @} */
 #else /* SICSLOWPAN_CONF_FRAG */
@@ -454,6 +511,113 @@ uncompress_addr(uip_ipaddr_t *ipaddr, uint8_t const prefix[],
   PRINTF("\n");
 }
 
+#if SICSLOWPAN_COMPRESS_RPI
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Compress the RPL hop-by-hop option into an RPI 6LoRH
+ *
+ * If the packet in uip_buf starts with a hop-by-hop header that holds
+ * only the RPL option, and its RPL instance advertises it, the header
+ * is replaced by a page 1 dispatch and an RPI 6LoRH written at
+ * packetbuf_ptr:
+ * \verbatim
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * |1 1 1 1 0 0 0 1|1 0 0|O|R|F|I|K|  6LoRH type 5 | [instance]    |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * | sender rank (1 or 2 bytes)    |
+ * +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * \endverbatim
+ * The instance is elided (I) when it is 0 and the low byte of the
+ * rank (K) when it is 0.
+ * \return The number of bytes written, 0 if the hop-by-hop header has
+ * to be carried inline.
+ */
+static uint8_t
+compress_rpi(void)
+{
+  uint8_t *hbh = (uint8_t *)UIP_IP_BUF + UIP_IPH_LEN;
+  uint8_t *ptr = packetbuf_ptr;
+  rpl_instance_t *instance;
+  uint8_t flags;
+
+  /* next header, length, option type, option length, flags, instance,
+     sender rank */
+  if(UIP_IP_BUF->proto != UIP_PROTO_HBHO || hbh[1] != 0 ||
+     hbh[2] != UIP_EXT_HDR_OPT_RPL || hbh[3] != 4 || (hbh[4] & 0x1f) != 0) {
+    return 0;
+  }
+  instance = rpl_get_instance(hbh[5]);
+  if(instance == NULL || !instance->rpi_compression) {
+    return 0;
+  }
+
+  /* The O, R and F flags of the option are its top three bits */
+  flags = SICSLOWPAN_6LORH_CRITICAL | (hbh[4] >> 3);
+  *ptr++ = SICSLOWPAN_DISPATCH_PAGE_1;
+  ptr += 2;
+  if(hbh[5] == 0) {
+    flags |= SICSLOWPAN_RPI_I;
+  } else {
+    *ptr++ = hbh[5];
+  }
+  *ptr++ = hbh[6];
+  if(hbh[7] == 0) {
+    flags |= SICSLOWPAN_RPI_K;
+  } else {
+    *ptr++ = hbh[7];
+  }
+  packetbuf_ptr[1] = flags;
+  packetbuf_ptr[2] = SICSLOWPAN_6LORH_TYPE_RPI;
+  return ptr - packetbuf_ptr;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * \brief Uncompress an RPI 6LoRH into the hop-by-hop header of
+ * sicslowpan_buf
+ *
+ * Called with the page 1 dispatch at PACKETBUF_HC1_PTR. The next
+ * header field of the hop-by-hop header is set by
+ * uncompress_hdr_hc06().
+ * \return The length of the hop-by-hop header, 0 if this is not an
+ * RPI 6LoRH followed by IPHC.
+ */
+static uint8_t
+uncompress_rpi(void)
+{
+  uint8_t *ptr = PACKETBUF_HC1_PTR + 1;
+  uint8_t *hbh = (uint8_t *)SICSLOWPAN_IP_BUF + UIP_IPH_LEN;
+  uint8_t flags;
+
+  if((ptr[0] & SICSLOWPAN_6LORH_MASK) != SICSLOWPAN_6LORH_CRITICAL ||
+     ptr[1] != SICSLOWPAN_6LORH_TYPE_RPI) {
+    return 0;
+  }
+  flags = ptr[0];
+  ptr += 2;
+
+  hbh[1] = 0;
+  hbh[2] = UIP_EXT_HDR_OPT_RPL;
+  hbh[3] = 4;
+  hbh[4] = (flags & (SICSLOWPAN_RPI_O | SICSLOWPAN_RPI_R | SICSLOWPAN_RPI_F)) << 3;
+  if(flags & SICSLOWPAN_RPI_I) {
+    hbh[5] = 0;
+  } else {
+    hbh[5] = *ptr++;
+  }
+  hbh[6] = *ptr++;
+  if(flags & SICSLOWPAN_RPI_K) {
+    hbh[7] = 0;
+  } else {
+    hbh[7] = *ptr++;
+  }
+
+  if((*ptr & 0xe0) != SICSLOWPAN_DISPATCH_IPHC) {
+    return 0;
+  }
+  packetbuf_hdr_len = ptr - packetbuf_ptr;
+  return SICSLOWPAN_RPI_HBH_LEN;
+}
+#endif /* SICSLOWPAN_COMPRESS_RPI */
 /*--------------------------------------------------------------------*/
 /**
  * \brief Compress IP/UDP header
@@ -493,6 +657,11 @@ static void
 compress_hdr_hc06(linkaddr_t *link_destaddr)
 {
   uint8_t tmp, iphc0, iphc1;
+  /* The header following the IPv6 header and the hop-by-hop header,
+     if that one is compressed separately */
+  uint8_t proto = UIP_IP_BUF->proto;
+  struct uip_udp_hdr *udp = UIP_UDP_BUF;
+  uint8_t ext_len = 0;
 #if DEBUG
   { uint16_t ndx;
     PRINTF("before compression (%d): ", UIP_IP_BUF->len[1]);
@@ -504,7 +673,16 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
   }
 #endif
 
-  hc06_ptr = packetbuf_ptr + 2;
+#if SICSLOWPAN_COMPRESS_RPI
+  packetbuf_hdr_len = compress_rpi();
+  if(packetbuf_hdr_len > 0) {
+    ext_len = SICSLOWPAN_RPI_HBH_LEN;
+    proto = ((struct uip_ext_hdr *)UIP_UDP_BUF)->next;
+    udp = (struct uip_udp_hdr *)((uint8_t *)UIP_UDP_BUF + ext_len);
+  }
+#endif /* SICSLOWPAN_COMPRESS_RPI */
+
+  hc06_ptr = packetbuf_ptr + packetbuf_hdr_len + 2;
   /*
    * As we copy some bit-length fields, in the IPHC encoding bytes,
    * we sometimes use |=
@@ -581,17 +759,18 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
 
   /* Next header. We compress it if UDP */
 #if UIP_CONF_UDP || UIP_CONF_ROUTER
-  if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
+  if(proto == UIP_PROTO_UDP) {
     iphc0 |= SICSLOWPAN_IPHC_NH_C;
   }
 #endif /*UIP_CONF_UDP*/
 #ifdef SICSLOWPAN_NH_COMPRESSOR 
-  if(SICSLOWPAN_NH_COMPRESSOR.is_compressable(UIP_IP_BUF->proto)) {
+  if(ext_len == 0 &&
+     SICSLOWPAN_NH_COMPRESSOR.is_compressable(UIP_IP_BUF->proto)) {
     iphc0 |= SICSLOWPAN_IPHC_NH_C;
   }
 #endif
   if ((iphc0 & SICSLOWPAN_IPHC_NH_C) == 0) {
-    *hc06_ptr = UIP_IP_BUF->proto;
+    *hc06_ptr = proto;
     hc06_ptr += 1;
   }
 
@@ -700,53 +879,53 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
     }
   }
 
-  uncomp_hdr_len = UIP_IPH_LEN;
+  uncomp_hdr_len = UIP_IPH_LEN + ext_len;
 
 #if UIP_CONF_UDP || UIP_CONF_ROUTER
   /* UDP header compression */
-  if(UIP_IP_BUF->proto == UIP_PROTO_UDP) {
+  if(proto == UIP_PROTO_UDP) {
     PRINTF("IPHC: Uncompressed UDP ports on send side: %x, %x\n",
-	   UIP_HTONS(UIP_UDP_BUF->srcport), UIP_HTONS(UIP_UDP_BUF->destport));
+	   UIP_HTONS(udp->srcport), UIP_HTONS(udp->destport));
     /* Mask out the last 4 bits can be used as a mask */
-    if(((UIP_HTONS(UIP_UDP_BUF->srcport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN) &&
-       ((UIP_HTONS(UIP_UDP_BUF->destport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN)) {
+    if(((UIP_HTONS(udp->srcport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN) &&
+       ((UIP_HTONS(udp->destport) & 0xfff0) == SICSLOWPAN_UDP_4_BIT_PORT_MIN)) {
       /* we can compress 12 bits of both source and dest */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_11;
       PRINTF("IPHC: remove 12 b of both source & dest with prefix 0xFOB\n");
       *(hc06_ptr + 1) =
-	(uint8_t)((UIP_HTONS(UIP_UDP_BUF->srcport) -
+	(uint8_t)((UIP_HTONS(udp->srcport) -
 		SICSLOWPAN_UDP_4_BIT_PORT_MIN) << 4) +
-	(uint8_t)((UIP_HTONS(UIP_UDP_BUF->destport) -
+	(uint8_t)((UIP_HTONS(udp->destport) -
 		SICSLOWPAN_UDP_4_BIT_PORT_MIN));
       hc06_ptr += 2;
-    } else if((UIP_HTONS(UIP_UDP_BUF->destport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
+    } else if((UIP_HTONS(udp->destport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
       /* we can compress 8 bits of dest, leave source. */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_01;
       PRINTF("IPHC: leave source, remove 8 bits of dest with prefix 0xF0\n");
-      memcpy(hc06_ptr + 1, &UIP_UDP_BUF->srcport, 2);
+      memcpy(hc06_ptr + 1, &udp->srcport, 2);
       *(hc06_ptr + 3) =
-	(uint8_t)((UIP_HTONS(UIP_UDP_BUF->destport) -
+	(uint8_t)((UIP_HTONS(udp->destport) -
 		SICSLOWPAN_UDP_8_BIT_PORT_MIN));
       hc06_ptr += 4;
-    } else if((UIP_HTONS(UIP_UDP_BUF->srcport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
+    } else if((UIP_HTONS(udp->srcport) & 0xff00) == SICSLOWPAN_UDP_8_BIT_PORT_MIN) {
       /* we can compress 8 bits of src, leave dest. Copy compressed port */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_10;
       PRINTF("IPHC: remove 8 bits of source with prefix 0xF0, leave dest. hch: %i\n", *hc06_ptr);
       *(hc06_ptr + 1) =
-	(uint8_t)((UIP_HTONS(UIP_UDP_BUF->srcport) -
+	(uint8_t)((UIP_HTONS(udp->srcport) -
 		SICSLOWPAN_UDP_8_BIT_PORT_MIN));
-      memcpy(hc06_ptr + 2, &UIP_UDP_BUF->destport, 2);
+      memcpy(hc06_ptr + 2, &udp->destport, 2);
       hc06_ptr += 4;
     } else {
       /* we cannot compress. Copy uncompressed ports, full checksum  */
       *hc06_ptr = SICSLOWPAN_NHC_UDP_CS_P_00;
       PRINTF("IPHC: cannot compress headers\n");
-      memcpy(hc06_ptr + 1, &UIP_UDP_BUF->srcport, 4);
+      memcpy(hc06_ptr + 1, &udp->srcport, 4);
       hc06_ptr += 5;
     }
     /* always inline the checksum  */
     if(1) {
-      memcpy(hc06_ptr, &UIP_UDP_BUF->udpchksum, 2);
+      memcpy(hc06_ptr, &udp->udpchksum, 2);
       hc06_ptr += 2;
     }
     uncomp_hdr_len += UIP_UDPH_LEN;
@@ -781,11 +960,23 @@ compress_hdr_hc06(linkaddr_t *link_destaddr)
  * \param ip_len Equal to 0 if the packet is not a fragment (IP length
  * is then inferred from the L2 length), non 0 if the packet is a 1st
  * fragment.
+ * \param ext_len Length of the hop-by-hop header already uncompressed
+ * after the IPv6 header from an RPI 6LoRH, 0 if none.
  */
 static void
-uncompress_hdr_hc06(uint16_t ip_len)
+uncompress_hdr_hc06(uint16_t ip_len, uint8_t ext_len)
 {
   uint8_t tmp, iphc0, iphc1;
+  /* Where the next header described by IPHC goes, and its place */
+  uint8_t *nh = &SICSLOWPAN_IP_BUF->proto;
+  struct uip_udp_hdr *udp = SICSLOWPAN_UDP_BUF;
+
+  if(ext_len > 0) {
+    /* A hop-by-hop header was uncompressed in front of it */
+    SICSLOWPAN_IP_BUF->proto = UIP_PROTO_HBHO;
+    nh = (uint8_t *)SICSLOWPAN_UDP_BUF;
+    udp = (struct uip_udp_hdr *)((uint8_t *)SICSLOWPAN_UDP_BUF + ext_len);
+  }
   /* at least two byte will be used for the encoding */
   hc06_ptr = packetbuf_ptr + packetbuf_hdr_len + 2;
 
@@ -841,8 +1032,8 @@ uncompress_hdr_hc06(uint16_t ip_len)
   /* Next Header */
   if((iphc0 & SICSLOWPAN_IPHC_NH_C) == 0) {
     /* Next header is carried inline */
-    SICSLOWPAN_IP_BUF->proto = *hc06_ptr;
-    PRINTF("IPHC: next header inline: %d\n", SICSLOWPAN_IP_BUF->proto);
+    *nh = *hc06_ptr;
+    PRINTF("IPHC: next header inline: %d\n", *nh);
     hc06_ptr += 1;
   }
 
@@ -927,55 +1118,55 @@ uncompress_hdr_hc06(uint16_t ip_len)
                       (uip_lladdr_t *)packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
     }
   }
-  uncomp_hdr_len += UIP_IPH_LEN;
+  uncomp_hdr_len += UIP_IPH_LEN + ext_len;
 
   /* Next header processing - continued */
   if((iphc0 & SICSLOWPAN_IPHC_NH_C)) {
     /* The next header is compressed, NHC is following */
     if((*hc06_ptr & SICSLOWPAN_NHC_UDP_MASK) == SICSLOWPAN_NHC_UDP_ID) {
       uint8_t checksum_compressed;
-      SICSLOWPAN_IP_BUF->proto = UIP_PROTO_UDP;
+      *nh = UIP_PROTO_UDP;
       checksum_compressed = *hc06_ptr & SICSLOWPAN_NHC_UDP_CHECKSUMC;
       PRINTF("IPHC: Incoming header value: %i\n", *hc06_ptr);
       switch(*hc06_ptr & SICSLOWPAN_NHC_UDP_CS_P_11) {
       case SICSLOWPAN_NHC_UDP_CS_P_00:
 	/* 1 byte for NHC, 4 byte for ports, 2 bytes chksum */
-	memcpy(&SICSLOWPAN_UDP_BUF->srcport, hc06_ptr + 1, 2);
-	memcpy(&SICSLOWPAN_UDP_BUF->destport, hc06_ptr + 3, 2);
+	memcpy(&udp->srcport, hc06_ptr + 1, 2);
+	memcpy(&udp->destport, hc06_ptr + 3, 2);
 	PRINTF("IPHC: Uncompressed UDP ports (ptr+5): %x, %x\n",
-	       UIP_HTONS(SICSLOWPAN_UDP_BUF->srcport), UIP_HTONS(SICSLOWPAN_UDP_BUF->destport));
+	       UIP_HTONS(udp->srcport), UIP_HTONS(udp->destport));
 	hc06_ptr += 5;
 	break;
 
       case SICSLOWPAN_NHC_UDP_CS_P_01:
         /* 1 byte for NHC + source 16bit inline, dest = 0xF0 + 8 bit inline */
 	PRINTF("IPHC: Decompressing destination\n");
-	memcpy(&SICSLOWPAN_UDP_BUF->srcport, hc06_ptr + 1, 2);
-	SICSLOWPAN_UDP_BUF->destport = UIP_HTONS(SICSLOWPAN_UDP_8_BIT_PORT_MIN + (*(hc06_ptr + 3)));
+	memcpy(&udp->srcport, hc06_ptr + 1, 2);
+	udp->destport = UIP_HTONS(SICSLOWPAN_UDP_8_BIT_PORT_MIN + (*(hc06_ptr + 3)));
 	PRINTF("IPHC: Uncompressed UDP ports (ptr+4): %x, %x\n",
-	       UIP_HTONS(SICSLOWPAN_UDP_BUF->srcport), UIP_HTONS(SICSLOWPAN_UDP_BUF->destport));
+	       UIP_HTONS(udp->srcport), UIP_HTONS(udp->destport));
 	hc06_ptr += 4;
 	break;
 
       case SICSLOWPAN_NHC_UDP_CS_P_10:
         /* 1 byte for NHC + source = 0xF0 + 8bit inline, dest = 16 bit inline*/
 	PRINTF("IPHC: Decompressing source\n");
-	SICSLOWPAN_UDP_BUF->srcport = UIP_HTONS(SICSLOWPAN_UDP_8_BIT_PORT_MIN +
+	udp->srcport = UIP_HTONS(SICSLOWPAN_UDP_8_BIT_PORT_MIN +
 					    (*(hc06_ptr + 1)));
-	memcpy(&SICSLOWPAN_UDP_BUF->destport, hc06_ptr + 2, 2);
+	memcpy(&udp->destport, hc06_ptr + 2, 2);
 	PRINTF("IPHC: Uncompressed UDP ports (ptr+4): %x, %x\n",
-	       UIP_HTONS(SICSLOWPAN_UDP_BUF->srcport), UIP_HTONS(SICSLOWPAN_UDP_BUF->destport));
+	       UIP_HTONS(udp->srcport), UIP_HTONS(udp->destport));
 	hc06_ptr += 4;
 	break;
 
       case SICSLOWPAN_NHC_UDP_CS_P_11:
 	/* 1 byte for NHC, 1 byte for ports */
-	SICSLOWPAN_UDP_BUF->srcport = UIP_HTONS(SICSLOWPAN_UDP_4_BIT_PORT_MIN +
+	udp->srcport = UIP_HTONS(SICSLOWPAN_UDP_4_BIT_PORT_MIN +
 					    (*(hc06_ptr + 1) >> 4));
-	SICSLOWPAN_UDP_BUF->destport = UIP_HTONS(SICSLOWPAN_UDP_4_BIT_PORT_MIN +
+	udp->destport = UIP_HTONS(SICSLOWPAN_UDP_4_BIT_PORT_MIN +
 					     ((*(hc06_ptr + 1)) & 0x0F));
 	PRINTF("IPHC: Uncompressed UDP ports (ptr+2): %x, %x\n",
-	       UIP_HTONS(SICSLOWPAN_UDP_BUF->srcport), UIP_HTONS(SICSLOWPAN_UDP_BUF->destport));
+	       UIP_HTONS(udp->srcport), UIP_HTONS(udp->destport));
 	hc06_ptr += 2;
 	break;
 
@@ -984,7 +1175,7 @@ uncompress_hdr_hc06(uint16_t ip_len)
 	return;
       }
       if(!checksum_compressed) { /* has_checksum, default  */
-	memcpy(&SICSLOWPAN_UDP_BUF->udpchksum, hc06_ptr, 2);
+	memcpy(&udp->udpchksum, hc06_ptr, 2);
 	hc06_ptr += 2;
 	PRINTF("IPHC: sicslowpan uncompress_hdr: checksum included\n");
       } else {
@@ -1014,8 +1205,9 @@ uncompress_hdr_hc06(uint16_t ip_len)
   }
   
   /* length field in UDP header */
-  if(SICSLOWPAN_IP_BUF->proto == UIP_PROTO_UDP) {
-    memcpy(&SICSLOWPAN_UDP_BUF->udplen, &SICSLOWPAN_IP_BUF->len[0], 2);
+  if(*nh == UIP_PROTO_UDP) {
+    udp->udplen = UIP_HTONS(((SICSLOWPAN_IP_BUF->len[0] << 8) |
+                             SICSLOWPAN_IP_BUF->len[1]) - ext_len);
   }
 
   return;
@@ -1184,6 +1376,8 @@ compress_hdr_hc1(linkaddr_t *link_destaddr)
  * \param ip_len Equal to 0 if the packet is not a fragment (IP length
  * is then inferred from the L2 length), non 0 if the packet is a 1st
  * fragment.
+ * \param ext_len Length of the hop-by-hop header already uncompressed
+ * after the IPv6 header from an RPI 6LoRH, 0 if none.
  */
 static void
 uncompress_hdr_hc1(uint16_t ip_len)
@@ -1369,6 +1563,9 @@ output(const uip_lladdr_t *localdest)
   /* The MAC address of the destination of the packet */
   linkaddr_t dest;
 
+  /* Whether dest is an anycast address instead of localdest */
+  uint8_t is_anycast = 0;
+
   /* Number of bytes processed. */
   uint16_t processed_ip_out_len;
 
@@ -1383,6 +1580,32 @@ output(const uip_lladdr_t *localdest)
   packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
                      SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
 
+#ifdef SICSLOWPAN_CONF_ANYCAST_ADDR
+  if(localdest != NULL) {
+    is_anycast = SICSLOWPAN_CONF_ANYCAST_ADDR(&UIP_IP_BUF->destipaddr,
+                                              (const linkaddr_t *)localdest,
+                                              &dest);
+  }
+#endif /* SICSLOWPAN_CONF_ANYCAST_ADDR */
+
+  if(localdest != NULL && !is_anycast) {
+    /* Tell the MAC when the neighbor keeps its radio on */
+    uip_ds6_nbr_t *nbr = uip_ds6_nbr_ll_lookup(localdest);
+    if(nbr != NULL && nbr->always_on) {
+      packetbuf_set_attr(PACKETBUF_ATTR_RECEIVER_ALWAYS_ON, 1);
+    }
+    /* ... and how often it checks the channel */
+    if(nbr != NULL && nbr->check_rate) {
+      packetbuf_set_attr(PACKETBUF_ATTR_RECEIVER_CHECK_RATE, nbr->check_rate);
+    }
+  }
+
+#if ENERGEST_WITH_CAUSES
+  /* Carry the cause of this packet down to the RDC layer, which
+     accounts the radio time of every (re)transmission to it. */
+  packetbuf_set_attr(PACKETBUF_ATTR_ENERGEST_CAUSE, energest_cause_next());
+#endif /* ENERGEST_WITH_CAUSES */
+
   if(callback) {
     /* call the attribution when the callback comes, but set attributes
        here ! */
@@ -1413,7 +1636,7 @@ output(const uip_lladdr_t *localdest)
    */
   if(localdest == NULL) {
     linkaddr_copy(&dest, &linkaddr_null);
-  } else {
+  } else if(!is_anycast) {
     linkaddr_copy(&dest, (const linkaddr_t *)localdest);
   }
   
@@ -1578,6 +1801,277 @@ output(const uip_lladdr_t *localdest)
   return 1;
 }
 
+#if SICSLOWPAN_CONF_FRAG
+/*--------------------------------------------------------------------*/
+/** Drop the reassembly contexts whose timer has expired */
+static void
+reass_expire(void)
+{
+  struct reass_context *c, *next;
+
+  for(c = list_head(reass_list); c != NULL; c = next) {
+    next = list_item_next(c);
+    if(timer_expired(&c->timer)) {
+      PRINTFI("sicslowpan input: reassembly timed out (tag %d)\n", c->tag);
+      list_remove(reass_list, c);
+      memb_free(&reass_memb, c);
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+/** Find the context the fragment from sender with tag and size belongs to */
+static struct reass_context *
+reass_lookup(const linkaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  struct reass_context *c;
+
+  for(c = list_head(reass_list); c != NULL; c = list_item_next(c)) {
+    if(c->tag == tag && c->len == size && linkaddr_cmp(&c->sender, sender)) {
+      return c;
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * Start reassembling a new packet. A sender that starts a new packet
+ * has given up on its previous one, so that context is reused. Else,
+ * when all contexts are in use, the least recently used one is
+ * dropped: as with a single buffer, a new packet is preferred over one
+ * that has stalled.
+ */
+static struct reass_context *
+reass_new(const linkaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  struct reass_context *c;
+
+  for(c = list_head(reass_list); c != NULL; c = list_item_next(c)) {
+    if(linkaddr_cmp(&c->sender, sender)) {
+      break;
+    }
+  }
+  if(c == NULL) {
+    c = memb_alloc(&reass_memb);
+  }
+  if(c == NULL) {
+    c = list_tail(reass_list);
+    PRINTFI("sicslowpan input: dropping reassembly (tag %d) for a new packet\n",
+            c->tag);
+  }
+  list_remove(reass_list, c);
+
+  c->len = size;
+  c->processed = 0;
+  c->tag = tag;
+  linkaddr_copy(&c->sender, sender);
+  timer_set(&c->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND);
+  list_push(reass_list, c);
+  PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
+          c->len, c->tag);
+  return c;
+}
+#if SICSLOWPAN_CONF_FRAG_FORWARDING
+/*--------------------------------------------------------------------*/
+/** Drop the forwarding entries whose timer has expired */
+static void
+frag_forward_expire(void)
+{
+  struct frag_forward *f, *next;
+
+  for(f = list_head(frag_forward_list); f != NULL; f = next) {
+    next = list_item_next(f);
+    if(timer_expired(&f->timer)) {
+      list_remove(frag_forward_list, f);
+      memb_free(&frag_forward_memb, f);
+    }
+  }
+}
+/*--------------------------------------------------------------------*/
+static struct frag_forward *
+frag_forward_lookup(const linkaddr_t *sender, uint16_t tag, uint16_t size)
+{
+  struct frag_forward *f;
+
+  for(f = list_head(frag_forward_list); f != NULL; f = list_item_next(f)) {
+    if(f->in_tag == tag && f->size == size && linkaddr_cmp(&f->sender, sender)) {
+      return f;
+    }
+  }
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+/**
+ * Relay a following fragment of a packet being forwarded. Only the
+ * datagram tag is rewritten, the rest of the fragment is sent as is.
+ */
+static void
+frag_forward_fragn(struct frag_forward *f, uint8_t frag_offset)
+{
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, f->out_tag);
+  f->processed = (uint16_t)(frag_offset << 3) +
+    packetbuf_datalen() - SICSLOWPAN_FRAGN_HDR_LEN;
+
+  /* Turn the received frame into one to be sent */
+  packetbuf_compact();
+  packetbuf_clear_hdr();
+  packetbuf_attr_clear();
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+
+  PRINTFI("sicslowpan input: forward fragment (tag %d -> %d, offset %d)\n",
+          f->in_tag, f->out_tag, frag_offset);
+  send_packet(&f->nexthop);
+
+  if(f->processed >= f->size) {
+    list_remove(frag_forward_list, f);
+    memb_free(&frag_forward_memb, f);
+  } else {
+    timer_restart(&f->timer);
+  }
+}
+/*--------------------------------------------------------------------*/
+/**
+ * Try to forward the first fragment held in reass instead of
+ * reassembling the packet. The RPL hop-by-hop option is checked and
+ * updated as uip_process() and tcpip_ipv6_output() would do for a
+ * reassembled packet, the headers are compressed again for the next
+ * hop and the fragment is sent with a tag of our own.
+ * \return 1 if the fragment was forwarded or the packet dropped, 0 if
+ * the packet has to be reassembled.
+ */
+static int
+frag_forward_frag1(struct reass_context *reass)
+{
+  struct uip_ip_hdr *ip = (struct uip_ip_hdr *)&reass->buf.u8[UIP_LLH_LEN];
+  struct frag_forward *f;
+  uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route;
+  const uip_lladdr_t *lladdr;
+  linkaddr_t dest;
+  uint8_t hdr_len;
+  int framer_hdrlen;
+  uint16_t payload_len;
+
+  if(uip_is_addr_mcast(&ip->destipaddr) ||
+     uip_ds6_is_my_addr(&ip->destipaddr) ||
+     ip->ttl <= 1) {
+    return 0;
+  }
+#if UIP_CONF_IPV6_RPL && RPL_INSERT_HBH_OPTION
+  /* Inserting the option changes the header length: leave it to the
+     IP layer. */
+  if(ip->proto != UIP_PROTO_HBHO) {
+    return 0;
+  }
+#endif /* UIP_CONF_IPV6_RPL && RPL_INSERT_HBH_OPTION */
+
+  /* Same next hop decision as tcpip_ipv6_output() */
+  if(uip_ds6_is_addr_onlink(&ip->destipaddr)) {
+    nexthop = &ip->destipaddr;
+  } else if((route = uip_ds6_route_lookup(&ip->destipaddr)) != NULL) {
+    nexthop = uip_ds6_route_nexthop(route);
+  } else {
+    nexthop = uip_ds6_defrt_choose();
+  }
+  if(nexthop == NULL) {
+    return 0;
+  }
+  lladdr = uip_ds6_nbr_lladdr_from_ipaddr(nexthop);
+  if(lladdr == NULL ||
+     linkaddr_cmp((const linkaddr_t *)lladdr, &reass->sender)) {
+    return 0;
+  }
+  linkaddr_copy(&dest, (const linkaddr_t *)lladdr);
+
+  f = memb_alloc(&frag_forward_memb);
+  if(f == NULL) {
+    return 0;
+  }
+
+  /* The compressor works on uip_buf */
+  hdr_len = uncomp_hdr_len;
+  payload_len = reass->processed - hdr_len;
+  memcpy(UIP_IP_BUF, ip, reass->processed);
+  UIP_IP_BUF->ttl--;
+
+#if UIP_CONF_IPV6_RPL
+  /* Loop detection and the rank, down and error flags of the RPL
+     option, for the packet as a whole. A packet that RPL drops is not
+     reassembled either: its following fragments find no context. If
+     the fragment cannot be forwarded below, the reassembled packet
+     goes through the same checks again; only the rank warning can be
+     counted twice, as the packet itself was accepted. */
+  uip_ext_len = 0;
+  if(UIP_IP_BUF->proto == UIP_PROTO_HBHO &&
+     rpl_verify_header(2)) {
+    PRINTFI("sicslowpan input: RPL option error, dropping fragmented packet\n");
+    memb_free(&frag_forward_memb, f);
+    return 1;
+  }
+  if(rpl_update_header_empty() || rpl_update_header_final(nexthop)) {
+    PRINTFI("sicslowpan input: RPL forward error, dropping fragmented packet\n");
+    memb_free(&frag_forward_memb, f);
+    return 1;
+  }
+  uip_ext_len = 0;
+#endif /* UIP_CONF_IPV6_RPL */
+
+  uncomp_hdr_len = 0;
+  packetbuf_hdr_len = 0;
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     SICSLOWPAN_MAX_MAC_TRANSMISSIONS);
+
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1
+  compress_hdr_hc1(&dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC1 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
+  compress_hdr_ipv6(&dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+  compress_hdr_hc06(&dest);
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
+
+  /* The payload of the first fragment starts right after the headers
+     that were decompressed; it cannot be moved. */
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+  framer_hdrlen = NETSTACK_FRAMER.length();
+  if(framer_hdrlen < 0) {
+    framer_hdrlen = 21;
+  }
+  if(uncomp_hdr_len != hdr_len ||
+     SICSLOWPAN_FRAG1_HDR_LEN + packetbuf_hdr_len + payload_len >
+     MAC_MAX_PAYLOAD - framer_hdrlen - NETSTACK_LLSEC.get_overhead()) {
+    memb_free(&frag_forward_memb, f);
+    return 0;
+  }
+
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | reass->len));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, my_tag);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+  memcpy(packetbuf_ptr + packetbuf_hdr_len,
+         (uint8_t *)UIP_IP_BUF + hdr_len, payload_len);
+  packetbuf_set_datalen(packetbuf_hdr_len + payload_len);
+
+  linkaddr_copy(&f->sender, &reass->sender);
+  linkaddr_copy(&f->nexthop, &dest);
+  f->in_tag = reass->tag;
+  f->out_tag = my_tag++;
+  f->size = reass->len;
+  f->processed = reass->processed;
+  timer_set(&f->timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND);
+  list_push(frag_forward_list, f);
+
+  PRINTFI("sicslowpan input: forward first fragment (tag %d -> %d)\n",
+          f->in_tag, f->out_tag);
+  send_packet(&dest);
+  return 1;
+}
+#endif /* SICSLOWPAN_CONF_FRAG_FORWARDING */
+#endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *  \param r The MAC layer
@@ -1599,10 +2093,14 @@ input(void)
   /* offset of the fragment in the IP packet */
   uint8_t frag_offset = 0;
   uint8_t is_fragment = 0;
+  /* length of the hop-by-hop header carried as an RPI 6LoRH */
+  uint8_t rpi_len = 0;
 #if SICSLOWPAN_CONF_FRAG
   /* tag of the fragment */
   uint16_t frag_tag = 0;
   uint8_t first_fragment = 0, last_fragment = 0;
+  /* the packet being reassembled, if this is a fragment */
+  struct reass_context *reass = NULL;
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
   /* init */
@@ -1616,11 +2114,11 @@ input(void)
      want to query us for it later. */
   last_rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
 #if SICSLOWPAN_CONF_FRAG
-  /* if reassembly timed out, cancel it */
-  if(timer_expired(&reass_timer)) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
+  /* cancel the reassemblies that timed out */
+  reass_expire();
+#if SICSLOWPAN_CONF_FRAG_FORWARDING
+  frag_forward_expire();
+#endif /* SICSLOWPAN_CONF_FRAG_FORWARDING */
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1652,77 +2150,64 @@ input(void)
       PRINTFI("size %d, tag %d, offset %d)\n",
              frag_size, frag_tag, frag_offset);
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
-
-      /* If this is the last fragment, we may shave off any extrenous
-         bytes at the end. We must be liberal in what we accept. */
-      PRINTFI("last_fragment?: processed_ip_in_len %d packetbuf_payload_len %d frag_size %d\n",
-              processed_ip_in_len, packetbuf_datalen() - packetbuf_hdr_len, frag_size);
-
-      if(processed_ip_in_len + packetbuf_datalen() - packetbuf_hdr_len >= frag_size) {
-        last_fragment = 1;
-      }
       is_fragment = 1;
       break;
     default:
       break;
   }
 
-  /* We are currently reassembling a packet, but have just received the first
-   * fragment of another packet. We can either ignore it and hope to receive
-   * the rest of the under-reassembly packet fragments, or we can discard the
-   * previous packet altogether, and start reassembling the new packet.
-   *
-   * We discard the previous packet, and start reassembling the new packet.
-   * This lessens the negative impacts of too high SICSLOWPAN_REASS_MAXAGE.
-   */
-#define PRIORITIZE_NEW_PACKETS 1
-#if PRIORITIZE_NEW_PACKETS
+  if(is_fragment) {
+#if SICSLOWPAN_CONF_FRAG_FORWARDING
+    struct frag_forward *f;
 
-  if(!is_fragment) {
-    /* Prioritize non-fragment packets too. */
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  } else if(processed_ip_in_len > 0 && first_fragment
-      && !linkaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))) {
-    sicslowpan_len = 0;
-    processed_ip_in_len = 0;
-  }
-#endif /* PRIORITIZE_NEW_PACKETS */
-
-  if(processed_ip_in_len > 0) {
-    /* reassembly is ongoing */
-    /*    printf("frag %d %d\n", reass_tag, frag_tag);*/
-    if((frag_size > 0 &&
-        (frag_size != sicslowpan_len ||
-         reass_tag  != frag_tag ||
-         !linkaddr_cmp(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER))))  ||
-       frag_size == 0) {
-      /*
-       * the packet is a fragment that does not belong to the packet
-       * being reassembled or the packet is not a fragment.
-       */
-      PRINTFI("sicslowpan input: Dropping 6lowpan packet that is not a fragment of the packet currently being reassembled\n");
-      return;
+    f = frag_forward_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                            frag_tag, frag_size);
+    if(f != NULL) {
+      if(!first_fragment) {
+        frag_forward_fragn(f, frag_offset);
+        return;
+      }
+      /* The first fragment was sent again: route it again. */
+      list_remove(frag_forward_list, f);
+      memb_free(&frag_forward_memb, f);
     }
-  } else {
-    /*
-     * reassembly is off
-     * start it if we received a fragment
-     */
-    if((frag_size > 0) && (frag_size <= UIP_BUFSIZE)) {
-      /* We are currently not reassembling a packet, but have received a packet fragment
-       * that is not the first one. */
-      if(is_fragment && !first_fragment) {
+#endif /* SICSLOWPAN_CONF_FRAG_FORWARDING */
+    reass = reass_lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                         frag_tag, frag_size);
+    if(reass == NULL) {
+      /* We are not reassembling this packet. Start it if we received
+       * its first fragment. */
+      if(!first_fragment || frag_size == 0 || frag_size > UIP_BUFSIZE) {
+        PRINTFI("sicslowpan input: Dropping 6lowpan fragment of a packet that is not being reassembled\n");
         return;
       }
+      reass = reass_new(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                        frag_tag, frag_size);
+    } else {
+      if(first_fragment) {
+        /* The first fragment was sent again: start over. */
+        reass->processed = 0;
+      }
+      /* Keep the list in least recently used order. */
+      list_remove(reass_list, reass);
+      list_push(reass_list, reass);
+    }
 
-      sicslowpan_len = frag_size;
-      reass_tag = frag_tag;
-      timer_set(&reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND);
-      PRINTFI("sicslowpan input: INIT FRAGMENTATION (len %d, tag %d)\n",
-             sicslowpan_len, reass_tag);
-      linkaddr_copy(&frag_sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+    /* If this is the last fragment, we may shave off any extrenous
+       bytes at the end. We must be liberal in what we accept. */
+    PRINTFI("last_fragment?: processed_ip_in_len %d packetbuf_payload_len %d frag_size %d\n",
+            reass->processed, packetbuf_datalen() - packetbuf_hdr_len, frag_size);
+    if(!first_fragment &&
+       reass->processed + packetbuf_datalen() - packetbuf_hdr_len >= frag_size) {
+      last_fragment = 1;
     }
+
+    sicslowpan_buf = reass->buf.u8;
+    sicslowpan_len = reass->len;
+  } else {
+    /* Packets that are not fragmented are decompressed straight into
+       uip_buf, and do not disturb the ongoing reassemblies. */
+    sicslowpan_buf = uip_buf;
   }
 
   if(packetbuf_hdr_len == SICSLOWPAN_FRAGN_HDR_LEN) {
@@ -1733,9 +2218,19 @@ input(void)
 
   /* Process next dispatch and headers */
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06
+#if SICSLOWPAN_COMPRESS_RPI
+  if(PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH] == SICSLOWPAN_DISPATCH_PAGE_1) {
+    PRINTFI("sicslowpan input: RPI 6LoRH\n");
+    rpi_len = uncompress_rpi();
+    if(rpi_len == 0) {
+      PRINTFI("sicslowpan input: unsupported 6LoRH\n");
+      return;
+    }
+  }
+#endif /* SICSLOWPAN_COMPRESS_RPI */
   if((PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH] & 0xe0) == SICSLOWPAN_DISPATCH_IPHC) {
     PRINTFI("sicslowpan input: IPHC\n");
-    uncompress_hdr_hc06(frag_size);
+    uncompress_hdr_hc06(frag_size, rpi_len);
   } else
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_HC06 */
     switch(PACKETBUF_HC1_PTR[PACKETBUF_HC1_DISPATCH]) {
@@ -1784,11 +2279,11 @@ input(void)
   {
     int req_size = UIP_LLH_LEN + uncomp_hdr_len + (uint16_t)(frag_offset << 3)
         + packetbuf_payload_len;
-    if(req_size > sizeof(sicslowpan_buf)) {
+    if(req_size > UIP_BUFSIZE) {
       PRINTF(
           "SICSLOWPAN: packet dropped, minimum required SICSLOWPAN_IP_BUF size: %d+%d+%d+%d=%d (current size: %d)\n",
           UIP_LLH_LEN, uncomp_hdr_len, (uint16_t)(frag_offset << 3),
-          packetbuf_payload_len, req_size, sizeof(sicslowpan_buf));
+          packetbuf_payload_len, req_size, UIP_BUFSIZE);
       return;
     }
   }
@@ -1798,19 +2293,27 @@ input(void)
   /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
 
 #if SICSLOWPAN_CONF_FRAG
-  if(frag_size > 0) {
+  if(reass != NULL) {
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
-      processed_ip_in_len += uncomp_hdr_len;
+      reass->processed += uncomp_hdr_len;
     }
     /* For the last fragment, we are OK if there is extrenous bytes at
        the end of the packet. */
     if(last_fragment != 0) {
-      processed_ip_in_len = frag_size;
+      reass->processed = frag_size;
     } else {
-      processed_ip_in_len += packetbuf_payload_len;
+      reass->processed += packetbuf_payload_len;
     }
-    PRINTF("processed_ip_in_len %d, packetbuf_payload_len %d\n", processed_ip_in_len, packetbuf_payload_len);
+    PRINTF("processed_ip_in_len %d, packetbuf_payload_len %d\n", reass->processed, packetbuf_payload_len);
+#if SICSLOWPAN_CONF_FRAG_FORWARDING
+    if(first_fragment != 0 && reass->processed < reass->len &&
+       frag_forward_frag1(reass)) {
+      list_remove(reass_list, reass);
+      memb_free(&reass_memb, reass);
+      return;
+    }
+#endif /* SICSLOWPAN_CONF_FRAG_FORWARDING */
 
   } else {
 #endif /* SICSLOWPAN_CONF_FRAG */
@@ -1823,14 +2326,17 @@ input(void)
    * the IP stack
    */
   PRINTF("sicslowpan_init processed_ip_in_len %d, sicslowpan_len %d\n",
-         processed_ip_in_len, sicslowpan_len);
-  if(processed_ip_in_len == 0 || (processed_ip_in_len == sicslowpan_len)) {
+         reass != NULL ? reass->processed : 0, sicslowpan_len);
+  if(reass == NULL || reass->processed == reass->len) {
     PRINTFI("sicslowpan input: IP packet ready (length %d)\n",
            sicslowpan_len);
-    memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
+    if(reass != NULL) {
+      memcpy((uint8_t *)UIP_IP_BUF, (uint8_t *)SICSLOWPAN_IP_BUF, sicslowpan_len);
+      list_remove(reass_list, reass);
+      memb_free(&reass_memb, reass);
+    }
     uip_len = sicslowpan_len;
     sicslowpan_len = 0;
-    processed_ip_in_len = 0;
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 #if DEBUG
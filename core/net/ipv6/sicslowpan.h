@@ -82,6 +82,23 @@
 #define SICSLOWPAN_DISPATCH_IPHC                    0x60 /* 011xxxxx = ... */
 #define SICSLOWPAN_DISPATCH_FRAG1                   0xc0 /* 11000xxx */
 #define SICSLOWPAN_DISPATCH_FRAGN                   0xe0 /* 11100xxx */
+#define SICSLOWPAN_DISPATCH_PAGE_1                  0xf1 /* 11110001 */
+/** @} */
+
+/**
+ * \name RPI 6LoRH encoding (RPL option of the hop-by-hop header, page 1)
+ * @{
+ */
+#define SICSLOWPAN_6LORH_CRITICAL                   0x80 /* 100xxxxx */
+#define SICSLOWPAN_6LORH_MASK                       0xe0
+#define SICSLOWPAN_6LORH_TYPE_RPI                   5
+#define SICSLOWPAN_RPI_O                            0x10 /* down */
+#define SICSLOWPAN_RPI_R                            0x08 /* rank error */
+#define SICSLOWPAN_RPI_F                            0x04 /* forwarding error */
+#define SICSLOWPAN_RPI_I                            0x02 /* instance 0, elided */
+#define SICSLOWPAN_RPI_K                            0x01 /* rank high byte only */
+/** Length of the hop-by-hop header holding only the RPL option */
+#define SICSLOWPAN_RPI_HBH_LEN                      8
 /** @} */
 
 /** \name HC1 encoding
@@ -75,6 +75,8 @@ typedef struct uip_ds6_nbr {
   uint8_t isrouter;
   uint8_t state;
   uint16_t link_metric;
+  uint8_t always_on; /* the neighbor keeps its radio on */
+  uint16_t check_rate; /* channel check rate of the neighbor, 0 if unknown */
 #if UIP_CONF_IPV6_QUEUE_PKT
   struct uip_packetqueue_handle packethandle;
 #define UIP_DS6_NBR_PACKET_LIFETIME CLOCK_SECOND * 4
@@ -61,6 +61,17 @@ MEMB(neighborroutememb, struct uip_ds6_route_neighbor_route, UIP_DS6_ROUTE_NB);
 LIST(routelist);
 MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 
+/* Routes are also indexed for uip_ds6_route_lookup(): /128 routes are
+   chained in hash buckets, shorter routes are on a list sorted by
+   decreasing prefix length, so the first match is the longest. */
+static uip_ds6_route_t *route_hash[UIP_DS6_ROUTE_HASH_SIZE];
+static uip_ds6_route_t *prefix_routes;
+/* Lookup stamps are 16 bits wide to keep routes small. Ages are
+   compared modulo 2^16, so a route that has not been looked up for
+   more than 65535 lookups may look recent again. That only makes the
+   choice of the route to evict approximate. */
+static uint16_t lookup_count;
+
 /* Default routes are held on the defaultrouterlist and their
    structures are allocated from the defaultroutermemb memory block.*/
 LIST(defaultrouterlist);
@@ -78,6 +89,49 @@ static int num_routes = 0;
 
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 /*---------------------------------------------------------------------------*/
+static uip_ds6_route_t **
+route_index_head(const uip_ipaddr_t *addr, uint8_t length)
+{
+  unsigned hash = 0;
+  int i;
+
+  if(length < 128) {
+    return &prefix_routes;
+  }
+  for(i = 0; i < sizeof(uip_ipaddr_t); i++) {
+    hash = hash * 31 + addr->u8[i];
+  }
+  return &route_hash[hash % UIP_DS6_ROUTE_HASH_SIZE];
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_index_add(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+
+  /* Keep the prefix list sorted, longest prefix first */
+  for(p = route_index_head(&r->ipaddr, r->length);
+      *p != NULL && (*p)->length >= r->length;
+      p = &(*p)->index_next);
+  r->index_next = *p;
+  *p = r;
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_index_rm(uip_ds6_route_t *r)
+{
+  uip_ds6_route_t **p;
+
+  for(p = route_index_head(&r->ipaddr, r->length);
+      *p != NULL;
+      p = &(*p)->index_next) {
+    if(*p == r) {
+      *p = r->index_next;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 #if DEBUG != DEBUG_NONE
 static void
 assert_nbr_routes_list_sane(void)
@@ -148,6 +202,8 @@ uip_ds6_route_init(void)
 {
   memb_init(&routememb);
   list_init(routelist);
+  memset(route_hash, 0, sizeof(route_hash));
+  prefix_routes = NULL;
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 
@@ -205,27 +261,28 @@ uip_ds6_route_num_routes(void)
 uip_ds6_route_t *
 uip_ds6_route_lookup(uip_ipaddr_t *addr)
 {
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
-  uint8_t longestmatch;
 
   PRINTF("uip-ds6-route: Looking up route for ");
   PRINT6ADDR(addr);
   PRINTF("\n");
 
 
-  found_route = NULL;
-  longestmatch = 0;
-  for(r = uip_ds6_route_head();
-      r != NULL;
-      r = uip_ds6_route_next(r)) {
-    if(r->length >= longestmatch &&
-       uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
-      longestmatch = r->length;
-      found_route = r;
-      /* check if total match - e.g. all 128 bits do match */
-      if(longestmatch == 128) {
-	break;
+  /* A /128 match is always the longest one */
+  for(found_route = *route_index_head(addr, 128);
+      found_route != NULL;
+      found_route = found_route->index_next) {
+    if(uip_ipaddr_cmp(addr, &found_route->ipaddr)) {
+      break;
+    }
+  }
+  if(found_route == NULL) {
+    for(found_route = prefix_routes;
+        found_route != NULL;
+        found_route = found_route->index_next) {
+      if(uip_ipaddr_prefixcmp(addr, &found_route->ipaddr,
+                              found_route->length)) {
+        break;
       }
     }
   }
@@ -236,20 +293,14 @@ uip_ds6_route_lookup(uip_ipaddr_t *addr)
     PRINTF(" via ");
     PRINT6ADDR(uip_ds6_route_nexthop(found_route));
     PRINTF("\n");
+
+    /* Remember when the route was last used: the least recently used
+       route is dropped when the table is full. */
+    found_route->last_lookup = ++lookup_count;
   } else {
     PRINTF("uip-ds6-route: No route found\n");
   }
 
-  if(found_route != NULL && found_route != list_head(routelist)) {
-    /* If we found a route, we put it at the start of the routeslist
-       list. The list is ordered by how recently we looked them up:
-       the least recently used route will be at the end of the
-       list - for fast lookups (assuming multiple packets to the same node). */
-
-    list_remove(routelist, found_route);
-    list_push(routelist, found_route);
-  }
-
   return found_route;
 }
 /*---------------------------------------------------------------------------*/
@@ -297,11 +348,17 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
        least recently used one we have. */
 
     if(uip_ds6_route_num_routes() == UIP_DS6_ROUTE_NB) {
-      /* Removing the oldest route entry from the route table. The
-         least recently used route is the first route on the list. */
+      /* Removing the least recently used route entry from the route
+         table. Lookup counts wrap, so compare ages. */
       uip_ds6_route_t *oldest;
 
-      oldest = list_tail(routelist); /* uip_ds6_route_head(); */
+      oldest = uip_ds6_route_head();
+      for(r = uip_ds6_route_next(oldest); r != NULL; r = uip_ds6_route_next(r)) {
+        if((uint16_t)(lookup_count - r->last_lookup) >
+           (uint16_t)(lookup_count - oldest->last_lookup)) {
+          oldest = r;
+        }
+      }
       PRINTF("uip_ds6_route_add: dropping route to ");
       PRINT6ADDR(&oldest->ipaddr);
       PRINTF("\n");
@@ -371,6 +428,8 @@ uip_ds6_route_add(uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+  r->last_lookup = lookup_count;
+  route_index_add(r);
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -407,8 +466,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     PRINT6ADDR(&route->ipaddr);
     PRINTF("\n");
 
-    /* Remove the route from the route list */
+    /* Remove the route from the route list and lookup index */
     list_remove(routelist, route);
+    route_index_rm(route);
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -420,6 +480,13 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
       uip_debug_ipaddr_print(&route->ipaddr);
       PRINTF("\n");
     }
+
+#if UIP_DS6_NOTIFICATIONS
+    /* Notify while the route and its next hop are still valid: memb
+       reuses the blocks of freed routes */
+    call_route_callback(UIP_DS6_NOTIFICATION_ROUTE_RM,
+        &route->ipaddr, uip_ds6_route_nexthop(route));
+#endif
     list_remove(route->neighbor_routes->route_list, neighbor_route);
     if(list_head(route->neighbor_routes->route_list) == NULL) {
       /* If this was the only route using this neighbor, remove the
@@ -433,11 +500,6 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     num_routes--;
 
     PRINTF("uip_ds6_route_rm num %d\n", num_routes);
-
-#if UIP_DS6_NOTIFICATIONS
-    call_route_callback(UIP_DS6_NOTIFICATION_ROUTE_RM,
-        &route->ipaddr, uip_ds6_route_nexthop(route));
-#endif
 #if 0 //(DEBUG & DEBUG_ANNOTATE) == DEBUG_ANNOTATE
     /* we need to check if this was the last route towards "nexthop" */
     /* if so - remove that link (annotation) */
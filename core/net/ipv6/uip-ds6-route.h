@@ -107,6 +107,16 @@ struct uip_ds6_route_neighbor_routes {
   LIST_STRUCT(route_list);
 };
 
+/** \brief Number of hash buckets for /128 routes, at least one */
+#ifdef UIP_DS6_ROUTE_CONF_HASH_SIZE
+#if UIP_DS6_ROUTE_CONF_HASH_SIZE < 1
+#error UIP_DS6_ROUTE_CONF_HASH_SIZE must be at least 1
+#endif
+#define UIP_DS6_ROUTE_HASH_SIZE UIP_DS6_ROUTE_CONF_HASH_SIZE
+#else /* UIP_DS6_ROUTE_CONF_HASH_SIZE */
+#define UIP_DS6_ROUTE_HASH_SIZE (UIP_DS6_ROUTE_NB > 0 ? UIP_DS6_ROUTE_NB : 1)
+#endif /* UIP_DS6_ROUTE_CONF_HASH_SIZE */
+
 /** \brief An entry in the routing table */
 typedef struct uip_ds6_route {
   struct uip_ds6_route *next;
@@ -116,6 +126,11 @@ typedef struct uip_ds6_route {
      belong to the neighbor table entry that this routing table entry
      uses. */
   struct uip_ds6_route_neighbor_routes *neighbor_routes;
+  /* Lookup index: next /128 route in the same hash bucket, or next
+     shorter route on the prefix list. */
+  struct uip_ds6_route *index_next;
+  /* Lookup count at the last lookup, for least recently used eviction */
+  uint16_t last_lookup;
   uip_ipaddr_t ipaddr;
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   UIP_DS6_ROUTE_STATE_TYPE state;
@@ -45,6 +45,7 @@
 #include <string.h>
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-icmp6.h"
+#include "sys/energest.h"
 #include "contiki-default-conf.h"
 
 #define DEBUG 0
@@ -314,6 +315,13 @@ uip_icmp6_send(const uip_ipaddr_t *dest, int type, int code, int payload_len)
 
   uip_len = UIP_IPH_LEN + UIP_ICMPH_LEN + payload_len;
   tcpip_ipv6_output();
+
+#if ENERGEST_WITH_CAUSES
+  /* sicslowpan takes the cause when it sends the packet. Clear it in
+     case the packet was dropped or queued before, so that it does not
+     stick to the next packet. */
+  energest_cause_next();
+#endif /* ENERGEST_WITH_CAUSES */
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -894,6 +894,12 @@ ext_hdr_options_process(void)
           PRINTF("RPL Option Error: Dropping Packet\n");
           return 1;
         }
+#if RPL_WITH_ANYCAST
+        /* A copy of an anycast packet that another parent forwarded */
+        if(rpl_anycast_is_duplicate(uip_ext_opt_offset)) {
+          return 1;
+        }
+#endif /* RPL_WITH_ANYCAST */
 #endif /* UIP_CONF_IPV6_RPL */
         uip_ext_opt_offset += (UIP_EXT_HDR_OPT_BUF->len) + 2;
         return 0;
@@ -46,16 +46,15 @@
 #include "lib/random.h"
 #include "net/mac/mac-sequence.h"
 #include "net/mac/contikimac/contikimac.h"
+#include "net/mac/frame802154.h"
 #include "net/netstack.h"
 #include "net/rime/rime.h"
 #include "sys/compower.h"
+#include "sys/ctimer.h"
+#include "sys/energest.h"
 #include "sys/pt.h"
 #include "sys/rtimer.h"
 
-#if REMOVE_STROBE_FROM_ONE_HOP_NODE_TO_SINK
-#include "net/rpl/rpl.h"
-#endif
-
 #include <string.h>
 
 /* TX/RX cycles are synchronized with neighbor wake periods */
@@ -64,6 +63,21 @@
 #else /* CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION */
 #define WITH_PHASE_OPTIMIZATION      1
 #endif /* CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION */
+/* Unicasts to neighbors that keep their radio on are sent once, without
+   a strobe train (see PACKETBUF_ATTR_RECEIVER_ALWAYS_ON). RPL learns
+   which neighbors do from their DIOs (RPL_CONF_WITH_MAC_INFO). */
+#ifdef CONTIKIMAC_CONF_WITH_ALWAYS_ON_NEIGHBORS
+#define WITH_ALWAYS_ON_NEIGHBORS     CONTIKIMAC_CONF_WITH_ALWAYS_ON_NEIGHBORS
+#else /* CONTIKIMAC_CONF_WITH_ALWAYS_ON_NEIGHBORS */
+#define WITH_ALWAYS_ON_NEIGHBORS     0
+#endif /* CONTIKIMAC_CONF_WITH_ALWAYS_ON_NEIGHBORS */
+/* Unicasts queued for the same neighbor are sent back-to-back after a
+   single wake-up, with FRAME_PENDING set on all but the last one */
+#ifdef CONTIKIMAC_CONF_WITH_BURST
+#define WITH_BURST                   CONTIKIMAC_CONF_WITH_BURST
+#else /* CONTIKIMAC_CONF_WITH_BURST */
+#define WITH_BURST                   1
+#endif /* CONTIKIMAC_CONF_WITH_BURST */
 /* More aggressive radio sleeping when channel is busy with other traffic */
 #ifndef WITH_FAST_SLEEP
 #define WITH_FAST_SLEEP              1
@@ -86,11 +100,97 @@
 #define WITH_PHASE_OPTIMIZATION 0
 #endif
 
+/* Every frame ends with a one-byte trailer telling where in its
+   wake-up cycle the sender was when the frame went out, so that
+   receivers learn the phase of the sender from overheard frames.
+   All nodes must use the same setting, and
+   SICSLOWPAN_CONF_MAC_MAX_PAYLOAD must leave room for the trailer. */
+#ifdef CONTIKIMAC_CONF_WITH_PHASE_ANNOUNCEMENT
+#define WITH_PHASE_ANNOUNCEMENT      CONTIKIMAC_CONF_WITH_PHASE_ANNOUNCEMENT
+#else /* CONTIKIMAC_CONF_WITH_PHASE_ANNOUNCEMENT */
+#define WITH_PHASE_ANNOUNCEMENT      0
+#endif /* CONTIKIMAC_CONF_WITH_PHASE_ANNOUNCEMENT */
+
+#if !WITH_PHASE_OPTIMIZATION
+#undef WITH_PHASE_ANNOUNCEMENT
+#define WITH_PHASE_ANNOUNCEMENT 0
+#endif
+
+/* Each node picks its own channel check rate at runtime, between
+   MIN_CHANNEL_CHECK_RATE and MAX_CHANNEL_CHECK_RATE, from the number
+   of unicast frames it receives. Rates are powers of two, so that the
+   wake-ups of a node stay on the grid of the slowest rate.  Senders
+   learn the rate of a receiver from the upper layer
+   (PACKETBUF_ATTR_RECEIVER_CHECK_RATE, which RPL fills in with
+   RPL_CONF_WITH_MAC_INFO); broadcasts and unicasts to
+   receivers of unknown rate strobe for the longest cycle. */
+#ifdef CONTIKIMAC_CONF_WITH_ADAPTIVE_CHECK_RATE
+#define WITH_ADAPTIVE_CHECK_RATE     CONTIKIMAC_CONF_WITH_ADAPTIVE_CHECK_RATE
+#else /* CONTIKIMAC_CONF_WITH_ADAPTIVE_CHECK_RATE */
+#define WITH_ADAPTIVE_CHECK_RATE     0
+#endif /* CONTIKIMAC_CONF_WITH_ADAPTIVE_CHECK_RATE */
+
+#if WITH_ADAPTIVE_CHECK_RATE
+#ifdef CONTIKIMAC_CONF_MIN_CHANNEL_CHECK_RATE
+#define MIN_CHANNEL_CHECK_RATE       CONTIKIMAC_CONF_MIN_CHANNEL_CHECK_RATE
+#else /* CONTIKIMAC_CONF_MIN_CHANNEL_CHECK_RATE */
+#define MIN_CHANNEL_CHECK_RATE       (NETSTACK_RDC_CHANNEL_CHECK_RATE / 2)
+#endif /* CONTIKIMAC_CONF_MIN_CHANNEL_CHECK_RATE */
+#ifdef CONTIKIMAC_CONF_MAX_CHANNEL_CHECK_RATE
+#define MAX_CHANNEL_CHECK_RATE       CONTIKIMAC_CONF_MAX_CHANNEL_CHECK_RATE
+#else /* CONTIKIMAC_CONF_MAX_CHANNEL_CHECK_RATE */
+#define MAX_CHANNEL_CHECK_RATE       (NETSTACK_RDC_CHANNEL_CHECK_RATE * 2)
+#endif /* CONTIKIMAC_CONF_MAX_CHANNEL_CHECK_RATE */
+#if MIN_CHANNEL_CHECK_RATE < 1 || MAX_CHANNEL_CHECK_RATE < MIN_CHANNEL_CHECK_RATE
+#error "ContikiMAC needs 1 <= MIN_CHANNEL_CHECK_RATE <= MAX_CHANNEL_CHECK_RATE"
+#endif
+
+/* The rate is reconsidered every CHECK_RATE_PERIOD. It is doubled
+   when at least CHECK_RATE_HIGH_LOAD unicast frames were received
+   during the period, and halved when at most CHECK_RATE_LOW_LOAD. */
+#ifdef CONTIKIMAC_CONF_CHECK_RATE_PERIOD
+#define CHECK_RATE_PERIOD            CONTIKIMAC_CONF_CHECK_RATE_PERIOD
+#else /* CONTIKIMAC_CONF_CHECK_RATE_PERIOD */
+#define CHECK_RATE_PERIOD            (60 * CLOCK_SECOND)
+#endif /* CONTIKIMAC_CONF_CHECK_RATE_PERIOD */
+#ifdef CONTIKIMAC_CONF_CHECK_RATE_HIGH_LOAD
+#define CHECK_RATE_HIGH_LOAD         CONTIKIMAC_CONF_CHECK_RATE_HIGH_LOAD
+#else /* CONTIKIMAC_CONF_CHECK_RATE_HIGH_LOAD */
+#define CHECK_RATE_HIGH_LOAD         20
+#endif /* CONTIKIMAC_CONF_CHECK_RATE_HIGH_LOAD */
+#ifdef CONTIKIMAC_CONF_CHECK_RATE_LOW_LOAD
+#define CHECK_RATE_LOW_LOAD          CONTIKIMAC_CONF_CHECK_RATE_LOW_LOAD
+#else /* CONTIKIMAC_CONF_CHECK_RATE_LOW_LOAD */
+#define CHECK_RATE_LOW_LOAD          4
+#endif /* CONTIKIMAC_CONF_CHECK_RATE_LOW_LOAD */
+
+/* A node for which CONTIKIMAC_CONF_PREFER_LOW_CHECK_RATE() returns
+   non-zero, such as a mobile leaf, stays at the lowest rate */
+#ifdef CONTIKIMAC_CONF_PREFER_LOW_CHECK_RATE
+uint8_t CONTIKIMAC_CONF_PREFER_LOW_CHECK_RATE(void);
+#endif /* CONTIKIMAC_CONF_PREFER_LOW_CHECK_RATE */
+
+static uint16_t channel_check_rate = NETSTACK_RDC_CHANNEL_CHECK_RATE;
+static uint16_t next_channel_check_rate = NETSTACK_RDC_CHANNEL_CHECK_RATE;
+/* The rate reported to the upper layer, which advertises it */
+static uint16_t announced_check_rate = NETSTACK_RDC_CHANNEL_CHECK_RATE;
+static uint16_t rx_load;
+static struct ctimer check_rate_timer;
+
+#define CHANNEL_CHECK_RATE           channel_check_rate
+#else /* WITH_ADAPTIVE_CHECK_RATE */
+#define CHANNEL_CHECK_RATE           NETSTACK_RDC_CHANNEL_CHECK_RATE
+#define MIN_CHANNEL_CHECK_RATE       NETSTACK_RDC_CHANNEL_CHECK_RATE
+#define MAX_CHANNEL_CHECK_RATE       NETSTACK_RDC_CHANNEL_CHECK_RATE
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
+
 /* CYCLE_TIME for channel cca checks, in rtimer ticks. */
-#ifdef CONTIKIMAC_CONF_CYCLE_TIME
+#if defined(CONTIKIMAC_CONF_CYCLE_TIME) && !WITH_ADAPTIVE_CHECK_RATE
 #define CYCLE_TIME (CONTIKIMAC_CONF_CYCLE_TIME)
+#define MAX_CYCLE_TIME CYCLE_TIME
 #else
-#define CYCLE_TIME (RTIMER_ARCH_SECOND / NETSTACK_RDC_CHANNEL_CHECK_RATE)
+#define CYCLE_TIME (RTIMER_ARCH_SECOND / CHANNEL_CHECK_RATE)
+#define MAX_CYCLE_TIME (RTIMER_ARCH_SECOND / MIN_CHANNEL_CHECK_RATE)
 #endif
 
 /* CHANNEL_CHECK_RATE is enforced to be a power of two.
@@ -179,8 +279,9 @@ static int we_are_receiving_burst = 0;
 
 
 /* STROBE_TIME is the maximum amount of time a transmitted packet
-   should be repeatedly transmitted as part of a transmission. */
-#define STROBE_TIME                        (CYCLE_TIME + 2 * CHECK_TIME)
+   should be repeatedly transmitted as part of a transmission to a
+   receiver that checks the channel every cycle_time. */
+#define STROBE_TIME(cycle_time)            ((cycle_time) + 2 * CHECK_TIME)
 
 /* GUARD_TIME is the time before the expected phase of a neighbor that
    a transmitted should begin transmitting packets. */
@@ -206,6 +307,19 @@ static int we_are_receiving_burst = 0;
    to a neighbor for which we have a phase lock. */
 #define MAX_PHASE_STROBE_TIME              RTIMER_ARCH_SECOND / 60
 
+#if WITH_PHASE_ANNOUNCEMENT
+/* Phase announcements express the time since the last channel check
+   in 1/255 of the longest cycle. Nodes that do not duty cycle
+   announce NONE. */
+#define PHASE_ANNOUNCEMENT_LEN             1
+#define PHASE_ANNOUNCEMENT_NONE            0xff
+#define MAX_FRAME_LEN                      (127 - 2)
+
+/* Time on air of a frame of len bytes, PHY header included, at 250 kbit/s */
+#define FRAME_AIRTIME(len) \
+  ((rtimer_clock_t)((uint32_t)((len) + 6) * RTIMER_ARCH_SECOND / 31250))
+#endif /* WITH_PHASE_ANNOUNCEMENT */
+
 #ifdef CONTIKIMAC_CONF_SEND_SW_ACK
 #define CONTIKIMAC_SEND_SW_ACK CONTIKIMAC_CONF_SEND_SW_ACK
 #else
@@ -214,6 +328,33 @@ static int we_are_receiving_burst = 0;
 
 #define ACK_LEN 3
 
+/* A node for which CONTIKIMAC_CONF_ANYCAST_IS_MEMBER() returns non-zero
+   for the receiver address of a frame takes that frame as its own. The
+   first such node to wake up ACKs the frame with its own address
+   appended, so the sender learns who took it. */
+#ifdef CONTIKIMAC_CONF_ANYCAST_IS_MEMBER
+#define WITH_ANYCAST 1
+int CONTIKIMAC_CONF_ANYCAST_IS_MEMBER(const linkaddr_t *addr);
+#if !CONTIKIMAC_SEND_SW_ACK || RDC_CONF_HARDWARE_ACK
+#error ContikiMAC anycast needs the software ACKs of CONTIKIMAC_CONF_SEND_SW_ACK
+#endif
+#define ANYCAST_ACK_LEN (ACK_LEN + LINKADDR_SIZE)
+#define MAX_ACK_LEN (ANYCAST_ACK_LEN + RDC_ACK_FEEDBACK_LEN)
+#else /* CONTIKIMAC_CONF_ANYCAST_IS_MEMBER */
+#define WITH_ANYCAST 0
+#define MAX_ACK_LEN (ACK_LEN + RDC_ACK_FEEDBACK_LEN)
+#endif /* CONTIKIMAC_CONF_ANYCAST_IS_MEMBER */
+
+/* Software ACKs may be longer than the 3 bytes of a plain 802.15.4
+   ACK: anycast appends the address of the node that took the frame,
+   RDC_WITH_ACK_FEEDBACK the RSSI and LQI of the data frame */
+#define WITH_LONG_ACK (MAX_ACK_LEN > ACK_LEN)
+#if WITH_LONG_ACK
+/* Time on air of the longest ACK, PHY header included, rounded up */
+#define LONG_ACK_WAIT_TIME \
+  ((rtimer_clock_t)(((uint32_t)MAX_ACK_LEN + 6) * RTIMER_ARCH_SECOND / 31250 + 1))
+#endif /* WITH_LONG_ACK */
+
 #include <stdio.h>
 static struct rtimer rt;
 static struct pt pt;
@@ -276,6 +417,25 @@ off(void)
 /*---------------------------------------------------------------------------*/
 static volatile rtimer_clock_t cycle_start;
 static char powercycle(struct rtimer *t, void *ptr);
+#if WITH_PHASE_ANNOUNCEMENT
+static uint8_t tx_frame[MAX_FRAME_LEN];
+/*---------------------------------------------------------------------------*/
+static uint8_t
+phase_announcement(uint8_t is_cycling)
+{
+  rtimer_clock_t now;
+
+  if(!is_cycling) {
+    return PHASE_ANNOUNCEMENT_NONE;
+  }
+  now = RTIMER_NOW();
+  if(RTIMER_CLOCK_LT(now, cycle_start)) {
+    return 0;
+  }
+  return (uint32_t)((now - cycle_start) % CYCLE_TIME) * 255 / MAX_CYCLE_TIME;
+}
+#endif /* WITH_PHASE_ANNOUNCEMENT */
+/*---------------------------------------------------------------------------*/
 static void
 schedule_powercycle(struct rtimer *t, rtimer_clock_t time)
 {
@@ -344,7 +504,9 @@ powercycle(struct rtimer *t, void *ptr)
 {
 #if SYNC_CYCLE_STARTS
   static volatile rtimer_clock_t sync_cycle_start;
-  static volatile uint8_t sync_cycle_phase;
+  static volatile uint16_t sync_cycle_phase;
+#elif WITH_ADAPTIVE_CHECK_RATE
+  static uint16_t cycle_count;
 #endif
 
   PT_BEGIN(&pt);
@@ -362,19 +524,30 @@ powercycle(struct rtimer *t, void *ptr)
 #if SYNC_CYCLE_STARTS
     /* Compute cycle start when RTIMER_ARCH_SECOND is not a multiple
        of CHANNEL_CHECK_RATE */
-    if(sync_cycle_phase++ == NETSTACK_RDC_CHANNEL_CHECK_RATE) {
+    if(sync_cycle_phase++ == CHANNEL_CHECK_RATE) {
       sync_cycle_phase = 0;
       sync_cycle_start += RTIMER_ARCH_SECOND;
       cycle_start = sync_cycle_start;
+#if WITH_ADAPTIVE_CHECK_RATE
+      /* Change rate on a second boundary only, where the wake-ups at
+         all rates coincide */
+      channel_check_rate = next_channel_check_rate;
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
     } else {
-#if (RTIMER_ARCH_SECOND * NETSTACK_RDC_CHANNEL_CHECK_RATE) > 65535
-      cycle_start = sync_cycle_start + ((unsigned long)(sync_cycle_phase*RTIMER_ARCH_SECOND))/NETSTACK_RDC_CHANNEL_CHECK_RATE;
+#if (RTIMER_ARCH_SECOND * MAX_CHANNEL_CHECK_RATE) > 65535
+      cycle_start = sync_cycle_start + ((unsigned long)(sync_cycle_phase*RTIMER_ARCH_SECOND))/CHANNEL_CHECK_RATE;
 #else
-      cycle_start = sync_cycle_start + (sync_cycle_phase*RTIMER_ARCH_SECOND)/NETSTACK_RDC_CHANNEL_CHECK_RATE;
+      cycle_start = sync_cycle_start + (sync_cycle_phase*RTIMER_ARCH_SECOND)/CHANNEL_CHECK_RATE;
 #endif
     }
 #else
     cycle_start += CYCLE_TIME;
+#if WITH_ADAPTIVE_CHECK_RATE
+    if(++cycle_count >= CHANNEL_CHECK_RATE) {
+      cycle_count = 0;
+      channel_check_rate = next_channel_check_rate;
+    }
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
 #endif
 
     packet_seen = 0;
@@ -502,6 +675,25 @@ broadcast_rate_drop(void)
 #endif /* CONTIKIMAC_CONF_BROADCAST_RATE_LIMIT */
 }
 /*---------------------------------------------------------------------------*/
+#if ENERGEST_WITH_CAUSES
+static unsigned long cause_transmit_start, cause_listen_start;
+
+static void
+cause_accounting_start(void)
+{
+  cause_transmit_start = energest_type_time(ENERGEST_TYPE_TRANSMIT);
+  cause_listen_start = energest_type_time(ENERGEST_TYPE_LISTEN);
+}
+/*---------------------------------------------------------------------------*/
+static void
+cause_accounting_stop(void)
+{
+  energest_cause_add(packetbuf_attr(PACKETBUF_ATTR_ENERGEST_CAUSE),
+                     energest_type_time(ENERGEST_TYPE_TRANSMIT) - cause_transmit_start,
+                     energest_type_time(ENERGEST_TYPE_LISTEN) - cause_listen_start);
+}
+#endif /* ENERGEST_WITH_CAUSES */
+/*---------------------------------------------------------------------------*/
 static int
 send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 	    struct rdc_buf_list *buf_list,
@@ -516,23 +708,17 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   int len;
   uint8_t is_broadcast = 0;
   uint8_t is_known_receiver = 0;
+  uint8_t is_receiver_always_on = 0;
+  rtimer_clock_t receiver_cycle_time = CYCLE_TIME;
   uint8_t collisions;
   int transmit_len;
   int ret;
   uint8_t contikimac_was_on;
   uint8_t seqno;
+#if RDC_WITH_ACK_FEEDBACK
+  uint8_t ack_feedback;
+#endif /* RDC_WITH_ACK_FEEDBACK */
 
-#if REMOVE_STROBE_FROM_ONE_HOP_NODE_TO_SINK
-  uint8_t one_hop_node = 0; 
-  rpl_dag_t *dag;
-  dag = rpl_get_any_dag();
-
-  if(dag->preferred_parent != NULL) {
-    if(LOG_NODEID_FROM_LINKADDR(packetbuf_addr(PACKETBUF_ADDR_RECEIVER)) == ROOT_ID)
-      one_hop_node = 1; 
-  }
-#endif
-  
   /* Exit if RDC and radio were explicitly turned off */
    if(!contikimac_is_on && !contikimac_keep_radio_on) {
     PRINTF("contikimac: radio is turned off\n");
@@ -571,7 +757,19 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
                packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[0],
                packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8[1]);
 #endif /* NETSTACK_CONF_WITH_IPV6 */
+#if WITH_ALWAYS_ON_NEIGHBORS
+    is_receiver_always_on = packetbuf_attr(PACKETBUF_ATTR_RECEIVER_ALWAYS_ON);
+#endif /* WITH_ALWAYS_ON_NEIGHBORS */
+  }
+
+#if WITH_ADAPTIVE_CHECK_RATE
+  if(!is_broadcast && packetbuf_attr(PACKETBUF_ATTR_RECEIVER_CHECK_RATE) > 0) {
+    receiver_cycle_time = RTIMER_ARCH_SECOND /
+      packetbuf_attr(PACKETBUF_ATTR_RECEIVER_CHECK_RATE);
+  } else {
+    receiver_cycle_time = MAX_CYCLE_TIME;
   }
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
 
   if(!packetbuf_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
     packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
@@ -582,12 +780,23 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   }
   
   transmit_len = packetbuf_totlen();
+#if WITH_PHASE_ANNOUNCEMENT
+  if(transmit_len + PHASE_ANNOUNCEMENT_LEN > MAX_FRAME_LEN) {
+    PRINTF("contikimac: no room for the phase announcement\n");
+    return MAC_TX_ERR_FATAL;
+  }
+  memcpy(tx_frame, packetbuf_hdrptr(), transmit_len);
+  tx_frame[transmit_len] = PHASE_ANNOUNCEMENT_NONE;
+  transmit_len += PHASE_ANNOUNCEMENT_LEN;
+  NETSTACK_RADIO.prepare(tx_frame, transmit_len);
+#else /* WITH_PHASE_ANNOUNCEMENT */
   NETSTACK_RADIO.prepare(packetbuf_hdrptr(), transmit_len);
+#endif /* WITH_PHASE_ANNOUNCEMENT */
   
-  if(!is_broadcast && !is_receiver_awake) {
+  if(!is_broadcast && !is_receiver_awake && !is_receiver_always_on) {
 #if WITH_PHASE_OPTIMIZATION
     ret = phase_wait(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
-                     CYCLE_TIME, GUARD_TIME,
+                     receiver_cycle_time, GUARD_TIME,
                      mac_callback, mac_callback_ptr, buf_list);
     if(ret == PHASE_DEFERRED) {
       return MAC_TX_DEFERRED;
@@ -620,6 +829,12 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
      the radio was doing a channel check. */
   off();
 
+#if ENERGEST_WITH_CAUSES
+  /* Everything from here on, including the CCAs before the strobe
+     train and listening for ACKs, is accounted to the packet's cause. */
+  cause_accounting_start();
+#endif /* ENERGEST_WITH_CAUSES */
+
 
   strobes = 0;
 
@@ -659,6 +874,9 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   if(collisions > 0) {
     we_are_sending = 0;
     off();
+#if ENERGEST_WITH_CAUSES
+    cause_accounting_stop();
+#endif /* ENERGEST_WITH_CAUSES */
     PRINTF("contikimac: collisions before sending\n");
     contikimac_is_on = contikimac_was_on;
     return MAC_TX_COLLISION;
@@ -679,7 +897,8 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
   for(strobes = 0, collisions = 0;
       got_strobe_ack == 0 && collisions == 0 &&
-      RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + STROBE_TIME); strobes++) {
+      RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + STROBE_TIME(receiver_cycle_time));
+      strobes++) {
 
     watchdog_periodic();
 
@@ -689,6 +908,12 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
       break;
     }
 
+#if WITH_PHASE_ANNOUNCEMENT
+    /* Each strobe announces the phase at the time it is sent */
+    tx_frame[transmit_len - 1] = phase_announcement(contikimac_was_on);
+    NETSTACK_RADIO.prepare(tx_frame, transmit_len);
+#endif /* WITH_PHASE_ANNOUNCEMENT */
+
     len = 0;
 
     {
@@ -728,11 +953,37 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
       if(!is_broadcast && (NETSTACK_RADIO.receiving_packet() ||
                            NETSTACK_RADIO.pending_packet() ||
                            NETSTACK_RADIO.channel_clear() == 0)) {
-        uint8_t ackbuf[ACK_LEN];
+        uint8_t ackbuf[MAX_ACK_LEN];
         wt = RTIMER_NOW();
         while(RTIMER_CLOCK_LT(RTIMER_NOW(), wt + AFTER_ACK_DETECTECT_WAIT_TIME)) { }
-
-        len = NETSTACK_RADIO.read(ackbuf, ACK_LEN);
+#if WITH_LONG_ACK
+        /* A longer ACK takes longer on the air */
+        while(NETSTACK_RADIO.receiving_packet() &&
+              RTIMER_CLOCK_LT(RTIMER_NOW(), wt + LONG_ACK_WAIT_TIME)) { }
+#endif /* WITH_LONG_ACK */
+
+        len = NETSTACK_RADIO.read(ackbuf, MAX_ACK_LEN);
+#if RDC_WITH_ACK_FEEDBACK
+        ack_feedback = 0;
+        if((len == ACK_LEN + RDC_ACK_FEEDBACK_LEN
+#if WITH_ANYCAST
+            || len == ANYCAST_ACK_LEN + RDC_ACK_FEEDBACK_LEN
+#endif /* WITH_ANYCAST */
+            ) && seqno == ackbuf[ACK_LEN - 1]) {
+          /* The receiver appended what it measured on our frame */
+          len -= RDC_ACK_FEEDBACK_LEN;
+          ack_feedback = 1;
+        }
+#endif /* RDC_WITH_ACK_FEEDBACK */
+#if WITH_ANYCAST
+        if(len == ANYCAST_ACK_LEN && seqno == ackbuf[ACK_LEN - 1]) {
+          /* An anycast frame: the node that took it is the receiver
+             from now on, for the phase and for the link statistics */
+          packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
+                             (linkaddr_t *)&ackbuf[ACK_LEN]);
+          len = ACK_LEN;
+        }
+#endif /* WITH_ANYCAST */
         if(len == ACK_LEN && seqno == ackbuf[ACK_LEN - 1]) {
           got_strobe_ack = 1;
 #if WITH_PHASE_OPTIMIZATION
@@ -740,9 +991,19 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 #endif
 
           /* hckim mobirpl MOBIRPL_RH_OF */
-          extern signed char cc2420_last_rssi;
-          rdc_ack_rssi = cc2420_last_rssi;
-          
+#if RDC_WITH_ACK_FEEDBACK
+          if(ack_feedback) {
+            /* The forward link, as seen by the receiver */
+            rdc_ack_rssi = (int8_t)ackbuf[len];
+            packetbuf_set_attr(PACKETBUF_ATTR_RSSI, (int8_t)ackbuf[len]);
+            packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, ackbuf[len + 1]);
+          } else
+#endif /* RDC_WITH_ACK_FEEDBACK */
+          {
+            extern signed char cc2420_last_rssi;
+            rdc_ack_rssi = cc2420_last_rssi;
+          }
+
           break;
         } else {
           PRINTF("contikimac: collisions while sending\n");
@@ -752,16 +1013,19 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
 #endif /* RDC_CONF_HARDWARE_ACK */
     }
 
-#if REMOVE_STROBE_FROM_ONE_HOP_NODE_TO_SINK
-    if(one_hop_node == 1) {
-        strobes++;
-        break;
+    if(is_receiver_always_on) {
+      /* The receiver is listening: one transmission is enough */
+      strobes++;
+      break;
     }
-#endif
   }
 
   off();
 
+#if ENERGEST_WITH_CAUSES
+  cause_accounting_stop();
+#endif /* ENERGEST_WITH_CAUSES */
+
   /* hckim mobirpl */
   /*
   static uint32_t total_uc_strobe_num;
@@ -817,7 +1081,8 @@ send_packet(mac_callback_t mac_callback, void *mac_callback_ptr,
   }
 
   if(!is_broadcast) {
-    if(collisions == 0 && is_receiver_awake == 0) {
+    if(collisions == 0 && is_receiver_awake == 0 &&
+       is_receiver_always_on == 0) {
       phase_update(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
 		   encounter_time, ret);
     }
@@ -839,6 +1104,38 @@ qsend_packet(mac_callback_t sent, void *ptr)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if WITH_BURST
+/* Make the FRAME_PENDING bit of the framed packet in the packetbuf say
+   whether another packet follows it in this burst. Packets keep the
+   frame they got on their first attempt, when the packets behind them
+   may not have been queued yet, so the bit is rewritten on every
+   attempt by parsing the 802.15.4 header and creating it again in
+   place. Frames that do not parse as 802.15.4, and secured frames,
+   whose header is authenticated, are left as they are. Returns the
+   bit that is sent. */
+static int
+set_frame_pending(int pending)
+{
+  frame802154_t frame;
+  int hdr_len;
+
+  hdr_len = frame802154_parse(packetbuf_hdrptr(), packetbuf_totlen(), &frame);
+  if(hdr_len == 0) {
+    return packetbuf_attr(PACKETBUF_ATTR_PENDING);
+  }
+  if(frame.fcf.frame_pending != pending
+#if LLSEC802154_SECURITY_LEVEL
+     && !frame.fcf.security_enabled
+#endif /* LLSEC802154_SECURITY_LEVEL */
+     ) {
+    frame.fcf.frame_pending = pending;
+    frame802154_create(&frame, packetbuf_hdrptr());
+  }
+  packetbuf_set_attr(PACKETBUF_ATTR_PENDING, frame.fcf.frame_pending);
+  return frame.fcf.frame_pending;
+}
+#endif /* WITH_BURST */
+/*---------------------------------------------------------------------------*/
 static void
 qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
 {
@@ -846,6 +1143,7 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
   struct rdc_buf_list *next;
   int ret;
   int is_receiver_awake;
+  int pending;
   
   if(buf_list == NULL) {
     return;
@@ -859,16 +1157,20 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     return;
   }
   
-  /* Create and secure frames in advance */
+  /* Create and secure frames in advance. Frames that were created on
+     an earlier attempt are already stored framed in their queuebuf, so
+     only the attribute is checked and the packetbuf is not loaded. */
   curr = buf_list;
   do {
     next = list_item_next(curr);
-    queuebuf_to_packetbuf(curr->buf);
-    if(!packetbuf_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
+    if(!queuebuf_attr(curr->buf, PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
+      queuebuf_to_packetbuf(curr->buf);
       /* create and secure this frame */
-      if(next != NULL) {
+#if WITH_BURST
+      if(next != NULL && !packetbuf_holds_broadcast()) {
         packetbuf_set_attr(PACKETBUF_ATTR_PENDING, 1);
       }
+#endif /* WITH_BURST */
       packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
       if(NETSTACK_FRAMER.create_and_secure() < 0) {
         PRINTF("contikimac: framer failed\n");
@@ -890,6 +1192,14 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
 
     /* Prepare the packetbuf */
     queuebuf_to_packetbuf(curr->buf);
+
+#if WITH_BURST
+    /* A burst to the broadcast address would keep every neighbor
+       awake, and each broadcast needs a full strobe train anyway */
+    pending = set_frame_pending(next != NULL && !packetbuf_holds_broadcast());
+#else /* WITH_BURST */
+    pending = 0;
+#endif /* WITH_BURST */
     
     /* hckim mobirpl MOBIRPL_RH_OF */
     rdc_ack_rssi = RPL_NOACK_RSSI;
@@ -897,6 +1207,8 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
     /* Send the current packet */
     ret = send_packet(sent, ptr, curr, is_receiver_awake);
     if(ret != MAC_TX_DEFERRED) {
+      /* The callback may free curr and reuse the packetbuf, so the
+         burst goes on according to the pending bit read above */
       mac_call_sent_callback(sent, ptr, ret, 1);
     }
 
@@ -910,7 +1222,7 @@ qsend_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
       /* The transmission failed, we stop the burst */
       next = NULL;
     }
-  } while((next != NULL) && packetbuf_attr(PACKETBUF_ATTR_PENDING));
+  } while(next != NULL && pending);
 }
 /*---------------------------------------------------------------------------*/
 /* Timer callback triggered when receiving a burst, after having
@@ -928,6 +1240,11 @@ input_packet(void)
 {
   static struct ctimer ct;
   int duplicate = 0;
+#if WITH_PHASE_ANNOUNCEMENT
+  rtimer_clock_t rx_time = RTIMER_NOW();
+  uint8_t announcement;
+  int frame_len;
+#endif /* WITH_PHASE_ANNOUNCEMENT */
 
 #if CONTIKIMAC_SEND_SW_ACK
   int original_datalen;
@@ -941,12 +1258,31 @@ input_packet(void)
     off();
   }
 
-  if(packetbuf_datalen() == ACK_LEN) {
+  if(packetbuf_datalen() == ACK_LEN
+#if WITH_ANYCAST
+     || packetbuf_datalen() == ANYCAST_ACK_LEN
+#endif /* WITH_ANYCAST */
+#if RDC_WITH_ACK_FEEDBACK
+     || packetbuf_datalen() == ACK_LEN + RDC_ACK_FEEDBACK_LEN
+#if WITH_ANYCAST
+     || packetbuf_datalen() == ANYCAST_ACK_LEN + RDC_ACK_FEEDBACK_LEN
+#endif /* WITH_ANYCAST */
+#endif /* RDC_WITH_ACK_FEEDBACK */
+     ) {
     /* Ignore ack packets */
     PRINTF("ContikiMAC: ignored ack\n");
     return;
   }
 
+#if WITH_PHASE_ANNOUNCEMENT
+  frame_len = packetbuf_datalen();
+  if(frame_len <= PHASE_ANNOUNCEMENT_LEN) {
+    return;
+  }
+  announcement = ((uint8_t *)packetbuf_dataptr())[frame_len - 1];
+  packetbuf_set_datalen(frame_len - PHASE_ANNOUNCEMENT_LEN);
+#endif /* WITH_PHASE_ANNOUNCEMENT */
+
   /*  printf("cycle_start 0x%02x 0x%02x\n", cycle_start, cycle_start % CYCLE_TIME);*/
 
   if(packetbuf_totlen() > 0 && NETSTACK_FRAMER.parse() >= 0) {
@@ -954,9 +1290,13 @@ input_packet(void)
        packetbuf_totlen() > 0 &&
        (linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
                      &linkaddr_node_addr) ||
-        packetbuf_holds_broadcast())) {
-      /* This is a regular packet that is destined to us or to the
-         broadcast address. */
+        packetbuf_holds_broadcast()
+#if WITH_ANYCAST
+        || CONTIKIMAC_CONF_ANYCAST_IS_MEMBER(packetbuf_addr(PACKETBUF_ADDR_RECEIVER))
+#endif /* WITH_ANYCAST */
+        )) {
+      /* This is a regular packet that is destined to us, to the
+         broadcast address or to an anycast address we belong to. */
 
       /* If FRAME_PENDING is set, we are receiving a packets in a burst */
       /* TODO To prevent denial-of-sleep attacks, the transceiver should
@@ -983,6 +1323,18 @@ input_packet(void)
       }
 #endif /* RDC_WITH_DUPLICATE_DETECTION */
 
+#if WITH_PHASE_ANNOUNCEMENT
+      if(announcement != PHASE_ANNOUNCEMENT_NONE) {
+        /* The sender checked the channel this long before it started
+           sending the frame we just received: learn its phase as if
+           it had acknowledged one of our strobes. */
+        phase_update(packetbuf_addr(PACKETBUF_ADDR_SENDER),
+                     rx_time - FRAME_AIRTIME(frame_len) -
+                     (rtimer_clock_t)((uint32_t)announcement * MAX_CYCLE_TIME / 255),
+                     MAC_TX_OK);
+      }
+#endif /* WITH_PHASE_ANNOUNCEMENT */
+
 #if CONTIKIMAC_CONF_COMPOWER
       /* Accumulate the power consumption for the packet reception. */
       compower_accumulate(&current_packet);
@@ -1004,21 +1356,44 @@ input_packet(void)
         frame802154_t info154;
         frame802154_parse(original_dataptr, original_datalen, &info154);
         if(info154.fcf.frame_type == FRAME802154_DATAFRAME &&
-            info154.fcf.ack_required != 0 &&
-            linkaddr_cmp((linkaddr_t *)&info154.dest_addr,
+            info154.fcf.ack_required != 0) {
+          uint8_t ackdata[MAX_ACK_LEN];
+          int ack_len = 0;
+
+          if(linkaddr_cmp((linkaddr_t *)&info154.dest_addr,
                 &linkaddr_node_addr)) {
-          uint8_t ackdata[ACK_LEN] = {0, 0, 0};
-
-          we_are_sending = 1;
-          ackdata[0] = FRAME802154_ACKFRAME;
-          ackdata[1] = 0;
-          ackdata[2] = info154.seq;
-          NETSTACK_RADIO.send(ackdata, ACK_LEN);
-          we_are_sending = 0;
+            ack_len = ACK_LEN;
+#if WITH_ANYCAST
+          } else if(CONTIKIMAC_CONF_ANYCAST_IS_MEMBER((linkaddr_t *)&info154.dest_addr)) {
+            linkaddr_copy((linkaddr_t *)&ackdata[ACK_LEN], &linkaddr_node_addr);
+            ack_len = ANYCAST_ACK_LEN;
+#endif /* WITH_ANYCAST */
+          }
+
+          if(ack_len > 0) {
+            we_are_sending = 1;
+            ackdata[0] = FRAME802154_ACKFRAME;
+            ackdata[1] = 0;
+            ackdata[2] = info154.seq;
+#if RDC_WITH_ACK_FEEDBACK
+            /* Tell the sender how its frame was received */
+            ackdata[ack_len] = (int8_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+            ackdata[ack_len + 1] = packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY);
+            ack_len += RDC_ACK_FEEDBACK_LEN;
+#endif /* RDC_WITH_ACK_FEEDBACK */
+            NETSTACK_RADIO.send(ackdata, ack_len);
+            we_are_sending = 0;
+          }
         }
       }
 #endif /* CONTIKIMAC_SEND_SW_ACK */
 
+#if WITH_ADAPTIVE_CHECK_RATE
+      if(!duplicate && !packetbuf_holds_broadcast()) {
+        rx_load++;
+      }
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
+
       if(!duplicate) {
         NETSTACK_MAC.input();
       }
@@ -1031,6 +1406,47 @@ input_packet(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if WITH_ADAPTIVE_CHECK_RATE
+static void
+adapt_check_rate(void *ptr)
+{
+  uint16_t rate = channel_check_rate;
+
+  if(rx_load >= CHECK_RATE_HIGH_LOAD && rate < MAX_CHANNEL_CHECK_RATE) {
+    if(rate > MAX_CHANNEL_CHECK_RATE / 2) {
+      rate = MAX_CHANNEL_CHECK_RATE;
+    } else {
+      rate <<= 1;
+    }
+  } else if(rx_load <= CHECK_RATE_LOW_LOAD && rate > MIN_CHANNEL_CHECK_RATE) {
+    if(rate < MIN_CHANNEL_CHECK_RATE * 2) {
+      rate = MIN_CHANNEL_CHECK_RATE;
+    } else {
+      rate >>= 1;
+    }
+  }
+#ifdef CONTIKIMAC_CONF_PREFER_LOW_CHECK_RATE
+  if(CONTIKIMAC_CONF_PREFER_LOW_CHECK_RATE()) {
+    rate = MIN_CHANNEL_CHECK_RATE;
+  }
+#endif /* CONTIKIMAC_CONF_PREFER_LOW_CHECK_RATE */
+  PRINTF("contikimac: load %u, check rate %u -> %u\n",
+         rx_load, channel_check_rate, rate);
+  rx_load = 0;
+
+  if(rate < channel_check_rate && rate != announced_check_rate) {
+    /* Announce a lower rate one period before switching to it, so
+       that neighbors do not strobe too briefly for us meanwhile */
+    announced_check_rate = rate;
+  } else {
+    announced_check_rate = rate;
+    next_channel_check_rate = rate;
+  }
+
+  ctimer_reset(&check_rate_timer);
+}
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
+/*---------------------------------------------------------------------------*/
 static void
 init(void)
 {
@@ -1046,6 +1462,9 @@ init(void)
   phase_init();
 #endif /* WITH_PHASE_OPTIMIZATION */
 
+#if WITH_ADAPTIVE_CHECK_RATE
+  ctimer_set(&check_rate_timer, CHECK_RATE_PERIOD, adapt_check_rate, NULL);
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -1077,7 +1496,12 @@ turn_off(int keep_radio_on)
 static unsigned short
 duty_cycle(void)
 {
+#if WITH_ADAPTIVE_CHECK_RATE
+  return (1ul * CLOCK_SECOND * (RTIMER_ARCH_SECOND / announced_check_rate)) /
+    RTIMER_ARCH_SECOND;
+#else /* WITH_ADAPTIVE_CHECK_RATE */
   return (1ul * CLOCK_SECOND * CYCLE_TIME) / RTIMER_ARCH_SECOND;
+#endif /* WITH_ADAPTIVE_CHECK_RATE */
 }
 /*---------------------------------------------------------------------------*/
 const struct rdc_driver contikimac_driver = {
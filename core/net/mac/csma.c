@@ -93,11 +93,15 @@ struct qbuf_metadata {
 
 /* Every neighbor has its own packet queue */
 struct neighbor_queue {
-  struct neighbor_queue *next;
+  struct neighbor_queue *next;       /* Next queue in the hash bucket */
+  struct neighbor_queue *ready_next; /* Next queue waiting to transmit */
   linkaddr_t addr;
   struct ctimer transmit_timer;
+  clock_time_t head_time; /* When the head packet reached the head */
+  int16_t deficit;        /* Deficit round robin credit, in bytes */
   uint8_t transmissions;
   uint8_t collisions, deferrals;
+  uint8_t ready;
   LIST_STRUCT(queued_packet_list);
 };
 
@@ -115,14 +119,49 @@ struct neighbor_queue {
 #define CSMA_MAX_PACKET_PER_NEIGHBOR MAX_QUEUED_PACKETS
 #endif /* CSMA_CONF_MAX_PACKET_PER_NEIGHBOR */
 
+/* The number of buckets in the neighbor queue hash table */
+#ifdef CSMA_CONF_NEIGHBOR_HASH_SIZE
+#define CSMA_NEIGHBOR_HASH_SIZE CSMA_CONF_NEIGHBOR_HASH_SIZE
+#else
+#define CSMA_NEIGHBOR_HASH_SIZE CSMA_MAX_NEIGHBOR_QUEUES
+#endif /* CSMA_CONF_NEIGHBOR_HASH_SIZE */
+
+/* Credit, in bytes, given to a neighbor queue each time the deficit
+   round robin scheduler passes over it. Every transmission attempt
+   is charged the frame length times the transmissions the RDC
+   reports. ContikiMAC, nullrdc and TSCH report one per attempt, not
+   per strobe, so queues share attempts by bytes sent. */
+#ifdef CSMA_CONF_DRR_QUANTUM
+#define CSMA_DRR_QUANTUM CSMA_CONF_DRR_QUANTUM
+#else
+#define CSMA_DRR_QUANTUM PACKETBUF_SIZE
+#endif /* CSMA_CONF_DRR_QUANTUM */
+
+/* The longest time a packet may stay at the head of its neighbor
+   queue before it is dropped. This bounds how long a neighbor that
+   went out of range can hold on to its queue, since collisions and
+   deferrals do not count against the transmission limit. 0 disables
+   the timeout. */
+#ifdef CSMA_CONF_HOL_TIMEOUT
+#define CSMA_HOL_TIMEOUT CSMA_CONF_HOL_TIMEOUT
+#else
+#define CSMA_HOL_TIMEOUT (8 * CLOCK_SECOND)
+#endif /* CSMA_CONF_HOL_TIMEOUT */
+
 #define MAX_QUEUED_PACKETS QUEUEBUF_NUM
 MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
 MEMB(packet_memb, struct rdc_buf_list, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
-LIST(neighbor_list);
+static struct neighbor_queue *neighbor_hash[CSMA_NEIGHBOR_HASH_SIZE];
+
+/* Neighbor queues whose transmit timer has fired, in round robin
+   order */
+static struct neighbor_queue *ready_head, *ready_tail;
+static struct ctimer dispatch_timer;
 
 static void packet_sent(void *ptr, int status, int num_transmissions);
 static void transmit_packet_list(void *ptr);
+static void free_packet(struct neighbor_queue *n, struct rdc_buf_list *p);
 
 /* hckim mobirpl MOBIRPL_RH_OF */
 int rdc_ack_rssi = RPL_NOACK_RSSI;
@@ -134,20 +173,99 @@ static uint16_t csma_uc_total_tx_num;
 static uint16_t csma_qloss_num;
 static uint16_t csma_nloss_num;
 
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue **
+neighbor_bucket(const linkaddr_t *addr)
+{
+  uint16_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = (h << 1) ^ addr->u8[i];
+  }
+  return &neighbor_hash[h % CSMA_NEIGHBOR_HASH_SIZE];
+}
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
-  struct neighbor_queue *n = list_head(neighbor_list);
-  while(n != NULL) {
+  struct neighbor_queue *n;
+
+  for(n = *neighbor_bucket(addr); n != NULL; n = n->next) {
     if(linkaddr_cmp(&n->addr, addr)) {
       return n;
     }
-    n = list_item_next(n);
   }
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+static void
+ready_remove(struct neighbor_queue *n)
+{
+  struct neighbor_queue *r, *prev;
+
+  if(!n->ready) {
+    return;
+  }
+  prev = NULL;
+  for(r = ready_head; r != NULL && r != n; r = r->ready_next) {
+    prev = r;
+  }
+  if(r != NULL) {
+    if(prev != NULL) {
+      prev->ready_next = n->ready_next;
+    } else {
+      ready_head = n->ready_next;
+    }
+    if(ready_tail == n) {
+      ready_tail = prev;
+    }
+  }
+  n->ready_next = NULL;
+  n->ready = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+ready_add(struct neighbor_queue *n, int first)
+{
+  if(n->ready) {
+    return;
+  }
+  n->ready = 1;
+  if(first) {
+    n->ready_next = ready_head;
+    ready_head = n;
+    if(ready_tail == NULL) {
+      ready_tail = n;
+    }
+    return;
+  }
+  n->ready_next = NULL;
+  if(ready_tail != NULL) {
+    ready_tail->ready_next = n;
+  } else {
+    ready_head = n;
+  }
+  ready_tail = n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_queue_free(struct neighbor_queue *n)
+{
+  struct neighbor_queue **p;
+
+  ctimer_stop(&n->transmit_timer);
+  ready_remove(n);
+  for(p = neighbor_bucket(&n->addr); *p != NULL; p = &(*p)->next) {
+    if(*p == n) {
+      *p = n->next;
+      break;
+    }
+  }
+  memb_free(&neighbor_memb, n);
+}
+/*---------------------------------------------------------------------------*/
 static clock_time_t
 default_timebase(void)
 {
@@ -165,17 +283,92 @@ default_timebase(void)
   return time;
 }
 /*---------------------------------------------------------------------------*/
+/* Drop the head packet of a queue that is not being transmitted and
+   report status to its sender. n may be freed. */
+static void
+drop_head(struct neighbor_queue *n, struct rdc_buf_list *q, int status)
+{
+  struct qbuf_metadata *metadata = (struct qbuf_metadata *)q->ptr;
+  mac_callback_t sent = metadata->sent;
+  void *cptr = metadata->cptr;
+  int num_tx = n->transmissions;
+
+  free_packet(n, q);
+#if MOBIRPL_RH_OF /* hckim mobirpl */
+  mac_call_sent_callback(sent, cptr, status, RPL_NOACK_RSSI);
+#else
+  mac_call_sent_callback(sent, cptr, status, num_tx);
+#endif
+}
+/*---------------------------------------------------------------------------*/
+/* Serve the neighbor queues whose transmit timer has fired, deficit
+   round robin. When a queue reaches the head of the ready list and
+   its credit does not cover its head packet, it gets CSMA_DRR_QUANTUM
+   more; if that is still not enough it goes to the back, unless it is
+   the only one waiting. A queue keeps its turn while its credit
+   covers its next packet (see transmit_packet_list). */
+static void
+dispatch(void *ptr)
+{
+  struct neighbor_queue *n;
+  struct rdc_buf_list *q;
+  int size;
+
+  while((n = ready_head) != NULL) {
+    q = list_head(n->queued_packet_list);
+    if(q == NULL) {
+      ready_remove(n);
+      continue;
+    }
+#if CSMA_HOL_TIMEOUT
+    if(clock_time() - n->head_time >= CSMA_HOL_TIMEOUT) {
+      PRINTF("csma: drop after %d transmissions, head of line timeout\n",
+             n->transmissions);
+      ready_remove(n);
+      drop_head(n, q, MAC_TX_ERR);
+      continue;
+    }
+#endif /* CSMA_HOL_TIMEOUT */
+    size = queuebuf_datalen(q->buf);
+    if(n->deficit < size) {
+      n->deficit += CSMA_DRR_QUANTUM;
+      if(n->deficit < size) {
+        if(n->ready_next != NULL) {
+          ready_head = n->ready_next;
+          n->ready_next = NULL;
+          ready_tail->ready_next = n;
+          ready_tail = n;
+        }
+        continue;
+      }
+    }
+    ready_remove(n);
+    PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
+        list_length(n->queued_packet_list));
+    /* Send packets in the neighbor's list */
+    NETSTACK_RDC.send_list(packet_sent, n, q);
+    break;
+  }
+
+  /* Serve one queue per round so that queues whose timers fire while
+     this one is transmitting get their turn. */
+  if(ready_head != NULL) {
+    ctimer_set(&dispatch_timer, 0, dispatch, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static void
 transmit_packet_list(void *ptr)
 {
   struct neighbor_queue *n = ptr;
+  struct rdc_buf_list *q;
   if(n) {
-    struct rdc_buf_list *q = list_head(n->queued_packet_list);
-    if(q != NULL) {
-      PRINTF("csma: preparing number %d %p, queue len %d\n", n->transmissions, q,
-          list_length(n->queued_packet_list));
-      /* Send packets in the neighbor's list */
-      NETSTACK_RDC.send_list(packet_sent, n, q);
+    /* A queue whose credit still covers its head packet is in the
+       middle of its turn and goes before the others. */
+    q = list_head(n->queued_packet_list);
+    ready_add(n, q != NULL && n->deficit >= queuebuf_datalen(q->buf));
+    if(ctimer_expired(&dispatch_timer)) {
+      ctimer_set(&dispatch_timer, 0, dispatch, NULL);
     }
   }
 }
@@ -197,14 +390,13 @@ free_packet(struct neighbor_queue *n, struct rdc_buf_list *p)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+      n->head_time = clock_time();
       /* Set a timer for next transmissions */
       ctimer_set(&n->transmit_timer, default_timebase(),
                  transmit_packet_list, n);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
-      ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      neighbor_queue_free(n);
     }
   }
 }
@@ -258,6 +450,16 @@ packet_sent(void *ptr, int status, int num_transmissions)
     is_broadcast = 1;
 
   if(q != NULL) {
+    /* Charge the queue for the air time this attempt used. */
+    if(status != MAC_TX_DEFERRED) {
+      int32_t cost = (int32_t)queuebuf_datalen(q->buf) * num_transmissions;
+      if(n->deficit - cost < -32767) {
+        n->deficit = -32767;
+      } else {
+        n->deficit -= cost;
+      }
+    }
+
     metadata = (struct qbuf_metadata *)q->ptr;
 
     if(metadata != NULL) {
@@ -302,7 +504,11 @@ packet_sent(void *ptr, int status, int num_transmissions)
          * [time, time + 2^backoff_exponent * time[ */
         time = time + (random_rand() % (backoff_transmissions * time));
 
-        if(n->transmissions < metadata->max_transmissions) {
+        if(n->transmissions < metadata->max_transmissions
+#if CSMA_HOL_TIMEOUT
+           && clock_time() - n->head_time < CSMA_HOL_TIMEOUT
+#endif /* CSMA_HOL_TIMEOUT */
+           ) {
           PRINTF("csma: retransmitting with time %lu %p\n", time, q);
           ctimer_set(&n->transmit_timer, time,
                      transmit_packet_list, n);
@@ -401,10 +607,14 @@ send_packet(mac_callback_t sent, void *ptr)
       n->transmissions = 0;
       n->collisions = 0;
       n->deferrals = 0;
+      n->deficit = 0;
+      n->ready = 0;
+      n->ready_next = NULL;
       /* Init packet list for this neighbor */
       LIST_STRUCT_INIT(n, queued_packet_list);
-      /* Add neighbor to the list */
-      list_add(neighbor_list, n);
+      /* Add neighbor to the hash table */
+      n->next = *neighbor_bucket(addr);
+      *neighbor_bucket(addr) = n;
     }
   }
 
@@ -442,6 +652,7 @@ send_packet(mac_callback_t sent, void *ptr)
                    list_length(n->queued_packet_list), memb_numfree(&packet_memb));
             /* If q is the first packet in the neighbor's queue, send asap */
             if(list_head(n->queued_packet_list) == q) {
+              n->head_time = clock_time();
               ctimer_set(&n->transmit_timer, 0, transmit_packet_list, n);
             }
             return;
@@ -454,8 +665,7 @@ send_packet(mac_callback_t sent, void *ptr)
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
       if(list_length(n->queued_packet_list) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
+        neighbor_queue_free(n);
       }
     } else {
       PRINTF("csma: Neighbor queue full\n");
@@ -504,6 +714,8 @@ init(void)
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
+  memset(neighbor_hash, 0, sizeof(neighbor_hash));
+  ready_head = ready_tail = NULL;
 }
 /*---------------------------------------------------------------------------*/
 const struct mac_driver csma_driver = {
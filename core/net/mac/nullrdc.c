@@ -107,6 +107,9 @@
 #endif /* NULLRDC_SEND_802154_ACK */
 
 #define ACK_LEN 3
+/* With RDC_WITH_ACK_FEEDBACK, software ACKs carry the RSSI and LQI
+   of the acknowledged frame after the sequence number */
+#define FEEDBACK_ACK_LEN (ACK_LEN + RDC_ACK_FEEDBACK_LEN)
 
 /* hckim mobirpl MOBIRPL_RH_OF */
 extern int rdc_ack_rssi;
@@ -171,7 +174,7 @@ send_one_packet(mac_callback_t sent, void *ptr)
              NETSTACK_RADIO.pending_packet() ||
              NETSTACK_RADIO.channel_clear() == 0) {
             int len;
-            uint8_t ackbuf[ACK_LEN];
+            uint8_t ackbuf[FEEDBACK_ACK_LEN];
 
             if(AFTER_ACK_DETECTED_WAIT_TIME > 0) {
               wt = RTIMER_NOW();
@@ -186,11 +189,22 @@ send_one_packet(mac_callback_t sent, void *ptr)
             }
 
             if(NETSTACK_RADIO.pending_packet()) {
-              len = NETSTACK_RADIO.read(ackbuf, ACK_LEN);
-              if(len == ACK_LEN && ackbuf[2] == dsn) {
+              len = NETSTACK_RADIO.read(ackbuf, FEEDBACK_ACK_LEN);
+              if((len == ACK_LEN || len == FEEDBACK_ACK_LEN) &&
+                 ackbuf[2] == dsn) {
                 /* hckim mobirpl MOBIRPL_RH_OF */
-                extern signed char cc2420_last_rssi;
-                rdc_ack_rssi = cc2420_last_rssi;
+#if RDC_WITH_ACK_FEEDBACK
+                if(len == FEEDBACK_ACK_LEN) {
+                  /* The forward link, as seen by the receiver */
+                  rdc_ack_rssi = (int8_t)ackbuf[ACK_LEN];
+                  packetbuf_set_attr(PACKETBUF_ATTR_RSSI, (int8_t)ackbuf[ACK_LEN]);
+                  packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, ackbuf[ACK_LEN + 1]);
+                } else
+#endif /* RDC_WITH_ACK_FEEDBACK */
+                {
+                  extern signed char cc2420_last_rssi;
+                  rdc_ack_rssi = cc2420_last_rssi;
+                }
 
                 /* Ack received */
                 RIMESTATS_ADD(ackrx);
@@ -286,7 +300,8 @@ packet_input(void)
 #endif
 
 #if NULLRDC_802154_AUTOACK
-  if(packetbuf_datalen() == ACK_LEN) {
+  if(packetbuf_datalen() == ACK_LEN ||
+     packetbuf_datalen() == FEEDBACK_ACK_LEN) {
     /* Ignore ack packets */
     PRINTF("nullrdc: ignored ack\n"); 
   } else
@@ -325,12 +340,17 @@ packet_input(void)
          info154.fcf.ack_required != 0 &&
          linkaddr_cmp((linkaddr_t *)&info154.dest_addr,
                       &linkaddr_node_addr)) {
-        uint8_t ackdata[ACK_LEN] = {0, 0, 0};
+        uint8_t ackdata[FEEDBACK_ACK_LEN] = {0, 0, 0};
 
         ackdata[0] = FRAME802154_ACKFRAME;
         ackdata[1] = 0;
         ackdata[2] = info154.seq;
-        NETSTACK_RADIO.send(ackdata, ACK_LEN);
+#if RDC_WITH_ACK_FEEDBACK
+        /* Tell the sender how its frame was received */
+        ackdata[ACK_LEN] = (int8_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+        ackdata[ACK_LEN + 1] = packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY);
+#endif /* RDC_WITH_ACK_FEEDBACK */
+        NETSTACK_RADIO.send(ackdata, FEEDBACK_ACK_LEN);
       }
     }
 #endif /* NULLRDC_SEND_ACK */
@@ -70,7 +70,12 @@ struct phase_queueitem {
 #define PHASE_DEFER_THRESHOLD 1
 #define PHASE_QUEUESIZE       8
 
+/* Failed transmissions after which a neighbor's phase is dropped */
+#ifdef PHASE_CONF_MAX_NOACKS
+#define MAX_NOACKS            PHASE_CONF_MAX_NOACKS
+#else /* PHASE_CONF_MAX_NOACKS */
 #define MAX_NOACKS            16
+#endif /* PHASE_CONF_MAX_NOACKS */
 
 #define MAX_NOACKS_TIME       CLOCK_SECOND * 30
 
@@ -134,6 +139,18 @@ phase_update(const linkaddr_t *neighbor, rtimer_clock_t time,
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+phase_remove(const linkaddr_t *neighbor)
+{
+  struct phase *e;
+
+  e = nbr_table_get_from_lladdr(nbr_phase, neighbor);
+  if(e != NULL) {
+    PRINTF("phase remove %d\n", neighbor->u8[0]);
+    nbr_table_remove(nbr_phase, e);
+  }
+}
+/*---------------------------------------------------------------------------*/
 static void
 send_packet(void *ptr)
 {
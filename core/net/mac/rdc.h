@@ -54,6 +54,25 @@
 #define RDC_WITH_DUPLICATE_DETECTION !LLSEC802154_CONF_SECURITY_LEVEL
 #endif /* RDC_CONF_WITH_DUPLICATE_DETECTION */
 
+/* When enabled, software-generated ACKs carry the RSSI and LQI the
+   receiver measured on the acknowledged data frame, appended after
+   the regular ACK. The sender then reports the forward-link RSSI
+   through rdc_ack_rssi instead of the RSSI of the ACK itself, which
+   with radio auto-ACK says little about the forward link. Both ends
+   must agree on this setting. */
+#ifdef RDC_CONF_WITH_ACK_FEEDBACK
+#define RDC_WITH_ACK_FEEDBACK RDC_CONF_WITH_ACK_FEEDBACK
+#else /* RDC_CONF_WITH_ACK_FEEDBACK */
+#define RDC_WITH_ACK_FEEDBACK 0
+#endif /* RDC_CONF_WITH_ACK_FEEDBACK */
+
+#if RDC_WITH_ACK_FEEDBACK
+/* One signed RSSI byte followed by one LQI byte */
+#define RDC_ACK_FEEDBACK_LEN 2
+#else /* RDC_WITH_ACK_FEEDBACK */
+#define RDC_ACK_FEEDBACK_LEN 0
+#endif /* RDC_WITH_ACK_FEEDBACK */
+
 /* List of packets to be sent by RDC layer */
 struct rdc_buf_list {
   struct rdc_buf_list *next;
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026, the MobiRPL contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         Glue between TSCH and RPL
+ */
+
+#include "contiki.h"
+#include "net/rpl/rpl-private.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/tsch-rpl.h"
+
+/*---------------------------------------------------------------------------*/
+/* Ask for DIOs right away instead of waiting for the next trickle
+   interval of the neighbors */
+void
+tsch_rpl_callback_joining_network(void)
+{
+  dis_output(NULL, 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Without TSCH the node cannot reach its parent any more */
+void
+tsch_rpl_callback_leaving_network(void)
+{
+  rpl_dag_t *dag;
+
+  dag = rpl_get_any_dag();
+  if(dag != NULL) {
+    rpl_local_repair(dag->instance);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_rpl_callback_parent_switch(rpl_parent_t *old, rpl_parent_t *new)
+{
+  if(new != NULL) {
+    tsch_set_time_source((const linkaddr_t *)nbr_table_get_lladdr(rpl_parents, new));
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,913 @@
+/*
+ * Copyright (c) 2026, the MobiRPL contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * This file is part of the Contiki operating system.
+ *
+ */
+
+/**
+ * \file
+ *         A time-slotted channel hopping (TSCH) radio duty cycling layer
+ *
+ *         Time is divided into slots, numbered network-wide by the
+ *         absolute slot number (ASN), and slots repeat in a slotframe.
+ *         Every slot of the slotframe is sent on a different channel
+ *         of the hopping sequence each time it comes around. The
+ *         schedule is autonomous, as in the 6TiSCH minimal
+ *         configuration and the autonomous cells of 6TiSCH MSF:
+ *
+ *         - Slot 0 is a shared cell in which every node listens, and
+ *           in which broadcasts and enhanced beacons (EBs) are sent.
+ *         - Every node listens in one more slot, and on a channel
+ *           offset, derived from a hash of its link-layer address.
+ *           Unicasts to a neighbor are sent in that neighbor's slot,
+ *           so the cells of a node follow from who its RPL parent and
+ *           children are without any negotiation.
+ *
+ *         A node joins by listening for an EB, which carries the ASN,
+ *         and then stays synchronized with a time source neighbor,
+ *         normally its RPL preferred parent (see tsch-rpl.c). The
+ *         coordinator, normally the RPL root, starts the ASN.
+ *
+ *         The driver sits below CSMA, which keeps the packet queues
+ *         and retransmissions: each send_list() call hands over the
+ *         head of one neighbor queue, which is sent in the next cell
+ *         to that neighbor. The EB format is a private beacon
+ *         payload, not the 802.15.4e information elements.
+ */
+
+#include "contiki.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/frame802154.h"
+#include "net/mac/mac-sequence.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "net/netstack.h"
+#include "lib/random.h"
+#include "sys/rtimer.h"
+#include "sys/ctimer.h"
+
+#include <string.h>
+
+#define DEBUG 0
+#if DEBUG
+#include <stdio.h>
+#define PRINTF(...) printf(__VA_ARGS__)
+#else /* DEBUG */
+#define PRINTF(...)
+#endif /* DEBUG */
+
+/* Slot timing, in rtimer ticks. The default is the 10 ms slot of
+   IEEE 802.15.4e. */
+#ifdef TSCH_CONF_SLOT_DURATION
+#define TSCH_SLOT_DURATION TSCH_CONF_SLOT_DURATION
+#else /* TSCH_CONF_SLOT_DURATION */
+#define TSCH_SLOT_DURATION (RTIMER_ARCH_SECOND / 100)
+#endif /* TSCH_CONF_SLOT_DURATION */
+
+/* Time from the start of a slot until a frame is sent */
+#ifdef TSCH_CONF_TX_OFFSET
+#define TSCH_TX_OFFSET TSCH_CONF_TX_OFFSET
+#else /* TSCH_CONF_TX_OFFSET */
+#define TSCH_TX_OFFSET (RTIMER_ARCH_SECOND / 500)
+#endif /* TSCH_CONF_TX_OFFSET */
+
+/* Time from TSCH_TX_OFFSET in the sender's slot until the receiver
+   detects the frame, e.g. the radio turnaround time of the sender */
+#ifdef TSCH_CONF_RX_DELAY
+#define TSCH_RX_DELAY TSCH_CONF_RX_DELAY
+#else /* TSCH_CONF_RX_DELAY */
+#define TSCH_RX_DELAY 0
+#endif /* TSCH_CONF_RX_DELAY */
+
+/* A receiver listens this long before and after the expected start of
+   a frame, to allow for synchronization errors */
+#ifdef TSCH_CONF_GUARD_TIME
+#define TSCH_GUARD_TIME TSCH_CONF_GUARD_TIME
+#else /* TSCH_CONF_GUARD_TIME */
+#define TSCH_GUARD_TIME (RTIMER_ARCH_SECOND / 1000)
+#endif /* TSCH_CONF_GUARD_TIME */
+
+/* How long a sender waits for an ACK to start after its frame */
+#ifdef TSCH_CONF_ACK_WAIT
+#define TSCH_ACK_WAIT TSCH_CONF_ACK_WAIT
+#else /* TSCH_CONF_ACK_WAIT */
+#define TSCH_ACK_WAIT (RTIMER_ARCH_SECOND / 500)
+#endif /* TSCH_CONF_ACK_WAIT */
+
+/* The air time of the longest frame, 133 bytes with the PHY header */
+#define MAX_FRAME_TIME (RTIMER_ARCH_SECOND / 200)
+
+/* The air time of a frame of the given length, 32 us per byte at
+   250 kbit/s, plus the 6 byte PHY header */
+#define FRAME_TIME(len) \
+  ((rtimer_clock_t)(((uint32_t)(len) + 6) * RTIMER_ARCH_SECOND / 31250))
+
+/* The number of slots in the slotframe. Slot 0 is the shared cell,
+   the others are the autonomous cells of the nodes. */
+#ifdef TSCH_CONF_SLOTFRAME_LENGTH
+#define TSCH_SLOTFRAME_LENGTH TSCH_CONF_SLOTFRAME_LENGTH
+#else /* TSCH_CONF_SLOTFRAME_LENGTH */
+#define TSCH_SLOTFRAME_LENGTH 17
+#endif /* TSCH_CONF_SLOTFRAME_LENGTH */
+
+#if TSCH_SLOTFRAME_LENGTH < 2
+#error TSCH_CONF_SLOTFRAME_LENGTH must be at least 2
+#endif
+
+/* The channels to hop over. With a length prime to the slotframe
+   length, every cell visits all channels. */
+#ifdef TSCH_CONF_HOPPING_SEQUENCE
+#define TSCH_HOPPING_SEQUENCE TSCH_CONF_HOPPING_SEQUENCE
+#else /* TSCH_CONF_HOPPING_SEQUENCE */
+#define TSCH_HOPPING_SEQUENCE { 15, 25, 26, 20 }
+#endif /* TSCH_CONF_HOPPING_SEQUENCE */
+
+/* The average interval between EBs */
+#ifdef TSCH_CONF_EB_PERIOD
+#define TSCH_EB_PERIOD TSCH_CONF_EB_PERIOD
+#else /* TSCH_CONF_EB_PERIOD */
+#define TSCH_EB_PERIOD (16 * CLOCK_SECOND)
+#endif /* TSCH_CONF_EB_PERIOD */
+
+/* A node that has not heard from its time source for this long leaves
+   the network and scans for EBs again */
+#ifdef TSCH_CONF_DESYNC_THRESHOLD
+#define TSCH_DESYNC_THRESHOLD TSCH_CONF_DESYNC_THRESHOLD
+#else /* TSCH_CONF_DESYNC_THRESHOLD */
+#define TSCH_DESYNC_THRESHOLD (60 * CLOCK_SECOND)
+#endif /* TSCH_CONF_DESYNC_THRESHOLD */
+
+/* How long a scanning node listens on each channel */
+#ifdef TSCH_CONF_CHANNEL_SCAN_DURATION
+#define TSCH_CHANNEL_SCAN_DURATION TSCH_CONF_CHANNEL_SCAN_DURATION
+#else /* TSCH_CONF_CHANNEL_SCAN_DURATION */
+#define TSCH_CHANNEL_SCAN_DURATION CLOCK_SECOND
+#endif /* TSCH_CONF_CHANNEL_SCAN_DURATION */
+
+/* The number of packets, to different neighbors, waiting for a cell */
+#ifdef TSCH_CONF_QUEUE_NUM
+#define TSCH_QUEUE_NUM TSCH_CONF_QUEUE_NUM
+#else /* TSCH_CONF_QUEUE_NUM */
+#define TSCH_QUEUE_NUM 8
+#endif /* TSCH_CONF_QUEUE_NUM */
+
+/* The number of received frames waiting to be passed up */
+#ifdef TSCH_CONF_RX_QUEUE_NUM
+#define TSCH_RX_QUEUE_NUM TSCH_CONF_RX_QUEUE_NUM
+#else /* TSCH_CONF_RX_QUEUE_NUM */
+#define TSCH_RX_QUEUE_NUM 4
+#endif /* TSCH_CONF_RX_QUEUE_NUM */
+
+/* All cells are shared, so a packet skips a random number of its
+   cells, below this window, before it is sent */
+#ifdef TSCH_CONF_BACKOFF_WINDOW
+#define TSCH_BACKOFF_WINDOW TSCH_CONF_BACKOFF_WINDOW
+#else /* TSCH_CONF_BACKOFF_WINDOW */
+#define TSCH_BACKOFF_WINDOW 2
+#endif /* TSCH_CONF_BACKOFF_WINDOW */
+
+/* Called after joining and after leaving a network */
+#ifdef TSCH_CONF_CALLBACK_JOINING_NETWORK
+#define TSCH_CALLBACK_JOINING_NETWORK TSCH_CONF_CALLBACK_JOINING_NETWORK
+void TSCH_CALLBACK_JOINING_NETWORK(void);
+#endif /* TSCH_CONF_CALLBACK_JOINING_NETWORK */
+#ifdef TSCH_CONF_CALLBACK_LEAVING_NETWORK
+#define TSCH_CALLBACK_LEAVING_NETWORK TSCH_CONF_CALLBACK_LEAVING_NETWORK
+void TSCH_CALLBACK_LEAVING_NETWORK(void);
+#endif /* TSCH_CONF_CALLBACK_LEAVING_NETWORK */
+
+#define ACK_LEN 3
+#define MAX_FRAME_LEN 127
+
+/* EB payload: ASN (4 bytes, little endian), join priority,
+   slotframe length */
+#define EB_LEN 6
+#define EB_ASN 0
+#define EB_JOIN_PRIORITY 4
+#define EB_SLOTFRAME_LENGTH 5
+
+static const uint8_t hopping_sequence[] = TSCH_HOPPING_SEQUENCE;
+#define HOPPING_SEQUENCE_LEN sizeof(hopping_sequence)
+
+enum {
+  PACKET_FREE,
+  PACKET_QUEUED,
+  PACKET_DONE
+};
+
+/* A packet handed over by the MAC, waiting for its cell */
+struct tsch_packet {
+  struct rdc_buf_list *buf;
+  mac_callback_t sent;
+  void *ptr;
+  linkaddr_t addr;
+  uint8_t slot_offset;
+  uint8_t channel_offset;
+  uint8_t backoff;
+  uint8_t ret;
+  int ack_rssi;
+  volatile uint8_t state;
+};
+
+struct rx_frame {
+  int16_t rssi;
+  uint8_t lqi;
+  uint8_t len;
+  uint8_t data[MAX_FRAME_LEN];
+};
+
+static struct tsch_packet tx_queue[TSCH_QUEUE_NUM];
+
+/* Frames are read from the radio in the slot and passed up from
+   tsch_process */
+static struct rx_frame rx_queue[TSCH_RX_QUEUE_NUM];
+static volatile uint8_t rx_put, rx_get;
+
+static uint8_t eb_buf[MAX_FRAME_LEN];
+static uint8_t eb_len;
+static uint8_t eb_payload;
+static volatile uint8_t eb_pending;
+static struct ctimer eb_timer;
+
+static volatile uint8_t associated;
+static uint8_t is_coordinator;
+static uint8_t join_priority;
+static linkaddr_t time_source;
+static volatile clock_time_t last_sync;
+
+/* The ASN and the start time of the next slot to be served */
+static uint32_t current_asn;
+static rtimer_clock_t current_slot_start;
+
+/* The autonomous cell of this node */
+static uint8_t own_slot_offset;
+static uint8_t own_channel_offset;
+
+static struct rtimer slot_timer;
+
+static uint8_t scan_channel;
+
+/* hckim mobirpl MOBIRPL_RH_OF */
+extern int rdc_ack_rssi;
+
+PROCESS(tsch_process, "TSCH");
+
+static void schedule_next_slot(void);
+static void start_scan(void);
+
+/*---------------------------------------------------------------------------*/
+static uint16_t
+addr_hash(const linkaddr_t *addr)
+{
+  uint16_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = h * 31 + addr->u8[i];
+  }
+  return h;
+}
+/*---------------------------------------------------------------------------*/
+/* The autonomous cell in which the given node listens */
+static uint8_t
+cell_slot_offset(const linkaddr_t *addr)
+{
+  return 1 + addr_hash(addr) % (TSCH_SLOTFRAME_LENGTH - 1);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+cell_channel_offset(const linkaddr_t *addr)
+{
+  return addr_hash(addr) % HOPPING_SEQUENCE_LEN;
+}
+/*---------------------------------------------------------------------------*/
+static void
+wait_until(rtimer_clock_t t)
+{
+  while(RTIMER_CLOCK_LT(RTIMER_NOW(), t)) { }
+}
+/*---------------------------------------------------------------------------*/
+/* The queued packet to send in the slot with the given offset, or NULL.
+   Packets that back off skip this cell. */
+static struct tsch_packet *
+packet_for_slot(uint8_t slot_offset)
+{
+  struct tsch_packet *p, *found;
+  int i;
+
+  found = NULL;
+  for(i = 0; i < TSCH_QUEUE_NUM; i++) {
+    p = &tx_queue[i];
+    if(p->state != PACKET_QUEUED || p->slot_offset != slot_offset) {
+      continue;
+    }
+    if(p->backoff > 0) {
+      p->backoff--;
+    } else if(found == NULL) {
+      found = p;
+    }
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+static int
+slot_is_active(uint32_t asn)
+{
+  uint8_t slot_offset;
+  int i;
+
+  slot_offset = asn % TSCH_SLOTFRAME_LENGTH;
+  if(slot_offset == 0 || slot_offset == own_slot_offset) {
+    return 1;
+  }
+  for(i = 0; i < TSCH_QUEUE_NUM; i++) {
+    if(tx_queue[i].state == PACKET_QUEUED &&
+       tx_queue[i].slot_offset == slot_offset) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+tx_slot(struct tsch_packet *p, uint8_t *frame, int len)
+{
+  uint8_t ackbuf[ACK_LEN];
+  uint8_t seqno;
+  rtimer_clock_t t0;
+  packetbuf_attr_t rssi, lqi;
+  int ret, ack_len, ack_rssi;
+
+  wait_until(current_slot_start + TSCH_TX_OFFSET);
+  NETSTACK_RADIO.prepare(frame, len);
+  ret = NETSTACK_RADIO.transmit(len);
+
+  if(p == NULL) {
+    /* An EB */
+    return;
+  }
+
+  if(ret == RADIO_TX_COLLISION) {
+    p->ret = MAC_TX_COLLISION;
+  } else if(ret != RADIO_TX_OK) {
+    p->ret = MAC_TX_ERR;
+  } else if(linkaddr_cmp(&p->addr, &linkaddr_null)) {
+    p->ret = MAC_TX_OK;
+  } else {
+    /* Wait for the ACK */
+    p->ret = MAC_TX_NOACK;
+    seqno = frame[2];
+    NETSTACK_RADIO.on();
+    t0 = RTIMER_NOW();
+    while(!NETSTACK_RADIO.receiving_packet() &&
+          !NETSTACK_RADIO.pending_packet() &&
+          RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + TSCH_ACK_WAIT)) { }
+    if(NETSTACK_RADIO.receiving_packet() ||
+       NETSTACK_RADIO.pending_packet()) {
+      t0 = RTIMER_NOW();
+      while(NETSTACK_RADIO.receiving_packet() &&
+            RTIMER_CLOCK_LT(RTIMER_NOW(), t0 + MAX_FRAME_TIME)) { }
+      rssi = packetbuf_attr(PACKETBUF_ATTR_RSSI);
+      lqi = packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY);
+      ack_len = NETSTACK_RADIO.read(ackbuf, ACK_LEN);
+      /* The radio driver leaves the RSSI of the ACK in the packetbuf */
+      ack_rssi = (int8_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+      packetbuf_set_attr(PACKETBUF_ATTR_RSSI, rssi);
+      packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, lqi);
+      if(ack_len == ACK_LEN && seqno == ackbuf[ACK_LEN - 1]) {
+        p->ret = MAC_TX_OK;
+        p->ack_rssi = ack_rssi;
+      } else {
+        p->ret = MAC_TX_COLLISION;
+      }
+    }
+    NETSTACK_RADIO.off();
+  }
+
+  p->state = PACKET_DONE;
+  process_poll(&tsch_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rx_slot(void)
+{
+  frame802154_t frame;
+  struct rx_frame *f;
+  uint8_t ackbuf[ACK_LEN];
+  rtimer_clock_t expected, rx_start;
+  packetbuf_attr_t rssi, lqi;
+  int hdr_len;
+  uint8_t next_put;
+
+  expected = current_slot_start + TSCH_TX_OFFSET + TSCH_RX_DELAY;
+  wait_until(expected - TSCH_GUARD_TIME);
+  NETSTACK_RADIO.on();
+  do {
+    rx_start = RTIMER_NOW();
+  } while(!NETSTACK_RADIO.receiving_packet() &&
+          !NETSTACK_RADIO.pending_packet() &&
+          RTIMER_CLOCK_LT(rx_start, expected + TSCH_GUARD_TIME));
+  if(!NETSTACK_RADIO.receiving_packet() &&
+     !NETSTACK_RADIO.pending_packet()) {
+    NETSTACK_RADIO.off();
+    return;
+  }
+  while(NETSTACK_RADIO.receiving_packet() &&
+        RTIMER_CLOCK_LT(RTIMER_NOW(), rx_start + MAX_FRAME_TIME)) { }
+
+  next_put = (rx_put + 1) % TSCH_RX_QUEUE_NUM;
+  if(next_put == rx_get) {
+    /* No room: the sender gets no ACK and tries again */
+    NETSTACK_RADIO.off();
+    return;
+  }
+  f = &rx_queue[rx_put];
+  /* The radio driver stores the RSSI and LQI in the packetbuf, which
+     the interrupted process may be using */
+  rssi = packetbuf_attr(PACKETBUF_ATTR_RSSI);
+  lqi = packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY);
+  f->len = NETSTACK_RADIO.read(f->data, MAX_FRAME_LEN);
+  f->rssi = packetbuf_attr(PACKETBUF_ATTR_RSSI);
+  f->lqi = packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY);
+  packetbuf_set_attr(PACKETBUF_ATTR_RSSI, rssi);
+  packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, lqi);
+  hdr_len = f->len > ACK_LEN ? frame802154_parse(f->data, f->len, &frame) : 0;
+  if(hdr_len > 0) {
+    if(frame.fcf.frame_type == FRAME802154_DATAFRAME &&
+       frame.fcf.ack_required &&
+       linkaddr_cmp((linkaddr_t *)&frame.dest_addr, &linkaddr_node_addr)) {
+      ackbuf[0] = FRAME802154_ACKFRAME;
+      ackbuf[1] = 0;
+      ackbuf[2] = frame.seq;
+      NETSTACK_RADIO.send(ackbuf, ACK_LEN);
+    }
+
+    /* Follow the slot timing of the time source */
+    if(!is_coordinator &&
+       linkaddr_cmp((linkaddr_t *)&frame.src_addr, &time_source)) {
+      current_slot_start += rx_start - expected;
+      last_sync = clock_time();
+    }
+
+    rx_put = next_put;
+    process_poll(&tsch_process);
+  }
+  NETSTACK_RADIO.off();
+}
+/*---------------------------------------------------------------------------*/
+static void
+slot_operation(struct rtimer *t, void *ptr)
+{
+  struct tsch_packet *p;
+  uint8_t slot_offset, channel_offset;
+  struct queuebuf *qb;
+  uint32_t asn;
+
+  if(!associated) {
+    return;
+  }
+
+  slot_offset = current_asn % TSCH_SLOTFRAME_LENGTH;
+  p = packet_for_slot(slot_offset);
+  if(slot_offset == 0) {
+    channel_offset = 0;
+  } else if(p != NULL) {
+    channel_offset = p->channel_offset;
+  } else {
+    channel_offset = own_channel_offset;
+  }
+  NETSTACK_RADIO.set_value(RADIO_PARAM_CHANNEL,
+      hopping_sequence[(current_asn + channel_offset) % HOPPING_SEQUENCE_LEN]);
+
+  if(slot_offset == 0 && eb_pending) {
+    /* EBs go first, with the ASN of the slot they are sent in */
+    asn = current_asn;
+    eb_buf[eb_payload + EB_ASN] = asn & 0xff;
+    eb_buf[eb_payload + EB_ASN + 1] = (asn >> 8) & 0xff;
+    eb_buf[eb_payload + EB_ASN + 2] = (asn >> 16) & 0xff;
+    eb_buf[eb_payload + EB_ASN + 3] = (asn >> 24) & 0xff;
+    tx_slot(NULL, eb_buf, eb_len);
+    eb_pending = 0;
+  } else if(p != NULL) {
+    qb = p->buf->buf;
+    tx_slot(p, queuebuf_dataptr(qb), queuebuf_datalen(qb));
+  } else if(slot_offset == 0 || slot_offset == own_slot_offset) {
+    rx_slot();
+  }
+
+  schedule_next_slot();
+}
+/*---------------------------------------------------------------------------*/
+static void
+schedule_next_slot(void)
+{
+  rtimer_clock_t now;
+
+  now = RTIMER_NOW();
+  do {
+    current_asn++;
+    current_slot_start += TSCH_SLOT_DURATION;
+  } while(!RTIMER_CLOCK_LT(now, current_slot_start) ||
+          !slot_is_active(current_asn));
+  rtimer_set(&slot_timer, current_slot_start, 1, slot_operation, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_scan(void)
+{
+  NETSTACK_RADIO.set_value(RADIO_PARAM_CHANNEL, hopping_sequence[scan_channel]);
+  NETSTACK_RADIO.on();
+}
+/*---------------------------------------------------------------------------*/
+static void
+eb_timer_callback(void *ptr)
+{
+  int hdr_len;
+  uint8_t *payload;
+
+  if(associated && !eb_pending) {
+    packetbuf_clear();
+    payload = packetbuf_dataptr();
+    memset(payload, 0, EB_LEN);
+    payload[EB_JOIN_PRIORITY] = join_priority;
+    payload[EB_SLOTFRAME_LENGTH] = TSCH_SLOTFRAME_LENGTH;
+    packetbuf_set_datalen(EB_LEN);
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_null);
+    packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+    packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_BEACONFRAME);
+    hdr_len = NETSTACK_FRAMER.create();
+    if(hdr_len >= 0 && packetbuf_totlen() <= MAX_FRAME_LEN) {
+      eb_len = packetbuf_copyto(eb_buf);
+      eb_payload = hdr_len;
+      eb_pending = 1;
+    }
+  }
+  ctimer_set(&eb_timer, TSCH_EB_PERIOD - TSCH_EB_PERIOD / 4 +
+             random_rand() % (TSCH_EB_PERIOD / 2), eb_timer_callback, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static void
+associate(uint32_t asn, rtimer_clock_t slot_start)
+{
+  own_slot_offset = cell_slot_offset(&linkaddr_node_addr);
+  own_channel_offset = cell_channel_offset(&linkaddr_node_addr);
+  current_asn = asn;
+  current_slot_start = slot_start;
+  last_sync = clock_time();
+  eb_pending = 0;
+  associated = 1;
+  NETSTACK_RADIO.off();
+  schedule_next_slot();
+  ctimer_set(&eb_timer, random_rand() % (TSCH_EB_PERIOD / 2),
+             eb_timer_callback, NULL);
+  PRINTF("tsch: associated at asn %lu, time source %d\n",
+         (unsigned long)asn, time_source.u8[LINKADDR_SIZE - 1]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+eb_input(rtimer_clock_t rx_start)
+{
+  uint8_t *payload;
+  uint32_t asn;
+  const linkaddr_t *sender;
+
+  if(packetbuf_datalen() < EB_LEN) {
+    return;
+  }
+  payload = packetbuf_dataptr();
+  if(payload[EB_SLOTFRAME_LENGTH] != TSCH_SLOTFRAME_LENGTH) {
+    return;
+  }
+  sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+
+  if(!associated) {
+    if(is_coordinator) {
+      return;
+    }
+    asn = (uint32_t)payload[EB_ASN] |
+      ((uint32_t)payload[EB_ASN + 1] << 8) |
+      ((uint32_t)payload[EB_ASN + 2] << 16) |
+      ((uint32_t)payload[EB_ASN + 3] << 24);
+    linkaddr_copy(&time_source, sender);
+    join_priority = payload[EB_JOIN_PRIORITY] + 1;
+    associate(asn, rx_start - TSCH_RX_DELAY - TSCH_TX_OFFSET);
+#ifdef TSCH_CALLBACK_JOINING_NETWORK
+    TSCH_CALLBACK_JOINING_NETWORK();
+#endif /* TSCH_CALLBACK_JOINING_NETWORK */
+  } else if(linkaddr_cmp(sender, &time_source)) {
+    join_priority = payload[EB_JOIN_PRIORITY] + 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+leave_network(void)
+{
+  int i;
+
+  PRINTF("tsch: leaving the network\n");
+  associated = 0;
+  eb_pending = 0;
+  ctimer_stop(&eb_timer);
+  for(i = 0; i < TSCH_QUEUE_NUM; i++) {
+    if(tx_queue[i].state == PACKET_QUEUED) {
+      tx_queue[i].ret = MAC_TX_ERR;
+      tx_queue[i].state = PACKET_DONE;
+    }
+  }
+  process_poll(&tsch_process);
+  start_scan();
+#ifdef TSCH_CALLBACK_LEAVING_NETWORK
+  TSCH_CALLBACK_LEAVING_NETWORK();
+#endif /* TSCH_CALLBACK_LEAVING_NETWORK */
+}
+/*---------------------------------------------------------------------------*/
+static void
+deliver_tx_results(void)
+{
+  struct tsch_packet *p;
+  mac_callback_t sent;
+  void *ptr;
+  int i;
+
+  for(i = 0; i < TSCH_QUEUE_NUM; i++) {
+    p = &tx_queue[i];
+    if(p->state != PACKET_DONE) {
+      continue;
+    }
+    queuebuf_to_packetbuf(p->buf->buf);
+    sent = p->sent;
+    ptr = p->ptr;
+    /* hckim mobirpl MOBIRPL_RH_OF */
+    rdc_ack_rssi = p->ack_rssi;
+    /* Free the entry first: the callback may hand over the next packet */
+    p->state = PACKET_FREE;
+    mac_call_sent_callback(sent, ptr, p->ret, 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+deliver_rx_frames(void)
+{
+  struct rx_frame *f;
+  int duplicate;
+
+  while(rx_get != rx_put) {
+    f = &rx_queue[rx_get];
+    packetbuf_clear();
+    memcpy(packetbuf_dataptr(), f->data, f->len);
+    packetbuf_set_datalen(f->len);
+    packetbuf_set_attr(PACKETBUF_ATTR_RSSI, f->rssi);
+    packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, f->lqi);
+    rx_get = (rx_get + 1) % TSCH_RX_QUEUE_NUM;
+
+    if(NETSTACK_FRAMER.parse() < 0) {
+      continue;
+    }
+    if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_BEACONFRAME) {
+      if(associated) {
+        eb_input(0);
+      }
+      continue;
+    }
+    if(!linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                     &linkaddr_node_addr) &&
+       !packetbuf_holds_broadcast()) {
+      continue;
+    }
+
+    duplicate = 0;
+#if RDC_WITH_DUPLICATE_DETECTION
+    duplicate = mac_sequence_is_duplicate();
+    if(duplicate) {
+      PRINTF("tsch: drop duplicate link layer packet %u\n",
+             packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO));
+    } else {
+      mac_sequence_register_seqno();
+    }
+#endif /* RDC_WITH_DUPLICATE_DETECTION */
+    if(!duplicate) {
+      NETSTACK_MAC.input();
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tsch_process, ev, data)
+{
+  static struct etimer et;
+
+  PROCESS_BEGIN();
+
+  if(!associated) {
+    start_scan();
+  }
+  etimer_set(&et, TSCH_CHANNEL_SCAN_DURATION);
+
+  while(1) {
+    PROCESS_YIELD();
+    if(ev == PROCESS_EVENT_POLL) {
+      deliver_tx_results();
+      deliver_rx_frames();
+    } else if(ev == PROCESS_EVENT_TIMER && data == &et) {
+      if(!associated) {
+        scan_channel = (scan_channel + 1) % HOPPING_SEQUENCE_LEN;
+        NETSTACK_RADIO.set_value(RADIO_PARAM_CHANNEL,
+                                 hopping_sequence[scan_channel]);
+      } else if(!is_coordinator &&
+                clock_time() - last_sync > TSCH_DESYNC_THRESHOLD) {
+        leave_network();
+      }
+      etimer_reset(&et);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_set_coordinator(int enable)
+{
+  if(enable && !is_coordinator) {
+    is_coordinator = 1;
+    join_priority = 0;
+    linkaddr_copy(&time_source, &linkaddr_null);
+    if(!associated) {
+      associate(0, RTIMER_NOW());
+    }
+  } else if(!enable) {
+    is_coordinator = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_set_time_source(const linkaddr_t *addr)
+{
+  if(addr != NULL && !is_coordinator &&
+     !linkaddr_cmp(addr, &time_source)) {
+    linkaddr_copy(&time_source, addr);
+    last_sync = clock_time();
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_is_associated(void)
+{
+  return associated;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_list(mac_callback_t sent, void *ptr, struct rdc_buf_list *buf_list)
+{
+  struct tsch_packet *p, *free_p;
+  const linkaddr_t *addr;
+  int i;
+
+  if(buf_list == NULL) {
+    return;
+  }
+  queuebuf_to_packetbuf(buf_list->buf);
+  if(!associated) {
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
+    return;
+  }
+
+  /* One packet per neighbor at a time */
+  addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  free_p = NULL;
+  for(i = 0; i < TSCH_QUEUE_NUM; i++) {
+    p = &tx_queue[i];
+    if(p->state == PACKET_FREE) {
+      if(free_p == NULL) {
+        free_p = p;
+      }
+    } else if(linkaddr_cmp(&p->addr, addr)) {
+      free_p = NULL;
+      break;
+    }
+  }
+  if(free_p == NULL) {
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR, 1);
+    return;
+  }
+  p = free_p;
+
+  if(!packetbuf_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED)) {
+    packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
+    if(NETSTACK_FRAMER.create_and_secure() < 0 ||
+       packetbuf_totlen() > MAX_FRAME_LEN) {
+      PRINTF("tsch: framer failed\n");
+      mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+      return;
+    }
+    packetbuf_set_attr(PACKETBUF_ATTR_IS_CREATED_AND_SECURED, 1);
+    queuebuf_update_from_packetbuf(buf_list->buf);
+  }
+
+  p->buf = buf_list;
+  p->sent = sent;
+  p->ptr = ptr;
+  if(packetbuf_holds_broadcast()) {
+    linkaddr_copy(&p->addr, &linkaddr_null);
+    p->slot_offset = 0;
+    p->channel_offset = 0;
+  } else {
+    linkaddr_copy(&p->addr, addr);
+    p->slot_offset = cell_slot_offset(addr);
+    p->channel_offset = cell_channel_offset(addr);
+  }
+  p->backoff = random_rand() % TSCH_BACKOFF_WINDOW;
+  p->ack_rssi = RPL_NOACK_RSSI;
+  /* Hand the packet over to the slot operation last */
+  p->state = PACKET_QUEUED;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_packet(mac_callback_t sent, void *ptr)
+{
+  /* Packets wait for their cell in the queue of the MAC above, which
+     hands them over with send_list() */
+  mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+input_packet(void)
+{
+  rtimer_clock_t rx_start;
+
+  /* Frames are read by the slot operation. Anything else that comes
+     in through the radio driver is heard while scanning. */
+  if(associated) {
+    return;
+  }
+  /* The radio driver passes frames up as soon as they end */
+  rx_start = RTIMER_NOW() - FRAME_TIME(packetbuf_datalen());
+  if(NETSTACK_FRAMER.parse() >= 0 &&
+     packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) == FRAME802154_BEACONFRAME) {
+    eb_input(rx_start);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(int keep_radio_on)
+{
+  /* The schedule alone decides when the radio is on */
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+channel_check_interval(void)
+{
+  return (uint32_t)TSCH_SLOTFRAME_LENGTH * TSCH_SLOT_DURATION *
+    CLOCK_SECOND / RTIMER_ARCH_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  scan_channel = random_rand() % HOPPING_SEQUENCE_LEN;
+  process_start(&tsch_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+const struct rdc_driver tsch_driver = {
+  "TSCH",
+  init,
+  send_packet,
+  send_list,
+  input_packet,
+  on,
+  off,
+  channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
@@ -62,6 +62,19 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error NBR_TABLE_CONF_HASH_SIZE must be larger than NBR_TABLE_CONF_MAX_NEIGHBORS
+#endif
+
+/* Open-addressing (linear probing) hash index from link-layer address to
+ * neighbor index. A slot holds the neighbor index + 1, 0 if empty */
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t nbr_table_slot_t;
+#else
+typedef uint16_t nbr_table_slot_t;
+#endif
+static nbr_table_slot_t hash_slots[NBR_TABLE_HASH_SIZE];
+
 /*---------------------------------------------------------------------------*/
 /* Get a key from a neighbor index */
 static nbr_table_key_t *
@@ -105,22 +118,80 @@ key_from_item(nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+/* Get the home slot of a link-layer address in the hash index */
+static unsigned
+hash_from_lladdr(const linkaddr_t *lladdr)
+{
+  unsigned hash = 0;
+  int i;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    hash = hash * 31 + lladdr->u8[i];
+  }
+  return hash % NBR_TABLE_HASH_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Add a neighbor index to the hash index, keyed by its link-layer address */
+static void
+hash_insert(int index)
+{
+  unsigned slot = hash_from_lladdr(&key_from_index(index)->lladdr);
+  while(hash_slots[slot] != 0) {
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_slots[slot] = index + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor index from the hash index. Must be called before the
+ * key's link-layer address is overwritten. Later entries of the probe
+ * sequence are shifted back, so that no tombstones are needed */
+static void
+hash_remove(int index)
+{
+  unsigned slot = hash_from_lladdr(&key_from_index(index)->lladdr);
+  unsigned next, home;
+
+  while(hash_slots[slot] != index + 1) {
+    if(hash_slots[slot] == 0) {
+      return;
+    }
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
+  }
+  hash_slots[slot] = 0;
+
+  next = slot;
+  while(1) {
+    next = (next + 1) % NBR_TABLE_HASH_SIZE;
+    if(hash_slots[next] == 0) {
+      return;
+    }
+    home = hash_from_lladdr(&key_from_index(hash_slots[next] - 1)->lladdr);
+    /* Leave the entry if its home slot is cyclically in (slot, next] */
+    if(slot <= next ? (slot < home && home <= next) :
+                      (slot < home || home <= next)) {
+      continue;
+    }
+    hash_slots[slot] = hash_slots[next];
+    hash_slots[next] = 0;
+    slot = next;
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
-  nbr_table_key_t *key;
+  unsigned slot;
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
-  key = list_head(nbr_table_keys);
-  while(key != NULL) {
-    if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
-      return index_from_key(key);
+  slot = hash_from_lladdr(lladdr);
+  while(hash_slots[slot] != 0) {
+    if(linkaddr_cmp(lladdr, &key_from_index(hash_slots[slot] - 1)->lladdr)) {
+      return hash_slots[slot] - 1;
     }
-    key = list_item_next(key);
+    slot = (slot + 1) % NBR_TABLE_HASH_SIZE;
   }
   return -1;
 }
@@ -216,8 +287,9 @@ nbr_table_allocate(void)
       }
       /* Empty used map */
       used_map[index_from_key(least_used_key)] = 0;
-      /* Remove neighbor from list */
+      /* Remove neighbor from list and hash index */
       list_remove(nbr_table_keys, least_used_key);
+      hash_remove(index_from_key(least_used_key));
       /* Return associated key */
       return least_used_key;
     }
@@ -298,6 +370,7 @@ nbr_table_add_lladdr(nbr_table_t *table, const linkaddr_t *lladdr)
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+    hash_insert(index);
   }
 
   /* Get item in the current table */
@@ -313,6 +313,11 @@ enum {
   PACKETBUF_ATTR_MAC_SEQNO,
   PACKETBUF_ATTR_MAC_ACK,
   PACKETBUF_ATTR_IS_CREATED_AND_SECURED,
+  PACKETBUF_ATTR_RECEIVER_ALWAYS_ON,
+  PACKETBUF_ATTR_RECEIVER_CHECK_RATE,
+#if ENERGEST_CONF_WITH_CAUSES
+  PACKETBUF_ATTR_ENERGEST_CAUSE,
+#endif /* ENERGEST_CONF_WITH_CAUSES */
   
   /* Scope 1 attributes: used between two neighbors only. */
 #if PACKETBUF_WITH_PACKET_TYPE
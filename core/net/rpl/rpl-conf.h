@@ -70,6 +70,15 @@
 #define RPL_OF rpl_mrhof
 #endif /* RPL_CONF_OF */
 
+/*
+ * A function called with the old and the new preferred parent whenever
+ * the preferred parent changes, e.g., tsch_rpl_callback_parent_switch
+ * to keep a TSCH node synchronized with its parent.
+ */
+#ifdef RPL_CONF_CALLBACK_PARENT_SWITCH
+#define RPL_CALLBACK_PARENT_SWITCH RPL_CONF_CALLBACK_PARENT_SWITCH
+#endif /* RPL_CONF_CALLBACK_PARENT_SWITCH */
+
 /* This value decides which DAG instance we should participate in by default. */
 #ifdef RPL_CONF_DEFAULT_INSTANCE
 #define RPL_DEFAULT_INSTANCE RPL_CONF_DEFAULT_INSTANCE
@@ -223,6 +232,52 @@
 #define RPL_INSERT_HBH_OPTION       1
 #endif
 
+/*
+ * Compressed hop-by-hop option
+ * When set on the root, the DIO configuration option tells the nodes of
+ * the DODAG to send the RPL option as an RPI 6LoRH, which sicslowpan
+ * must support (SICSLOWPAN_CONF_COMPRESS_RPI). Other nodes follow what
+ * their DODAG advertises.
+ */
+#ifdef RPL_CONF_WITH_RPI_COMPRESSION
+#define RPL_WITH_RPI_COMPRESSION    RPL_CONF_WITH_RPI_COMPRESSION
+#else
+#define RPL_WITH_RPI_COMPRESSION    0
+#endif
+
+/*
+ * Send a MAC information option in DIOs, telling neighbors how this
+ * node duty cycles its radio (whether it keeps it on, and its channel
+ * check rate), and
+ * record the option received from neighbors for the MAC layer.
+ * */
+#ifdef RPL_CONF_WITH_MAC_INFO
+#define RPL_WITH_MAC_INFO RPL_CONF_WITH_MAC_INFO
+#else
+#define RPL_WITH_MAC_INFO 0
+#endif
+
+/*
+ * Let upward packets go to a link-layer anycast address that stands
+ * for every parent that can forward them (see rpl_anycast_addr()).
+ * */
+#ifdef RPL_CONF_WITH_ANYCAST
+#define RPL_WITH_ANYCAST RPL_CONF_WITH_ANYCAST
+#else
+#define RPL_WITH_ANYCAST 0
+#endif
+
+/*
+ * Two parents may both take the same anycast frame, e.g. when their
+ * ACKs collide. A node remembers the last RPL_ANYCAST_DUPLICATES
+ * upward packets it received and drops copies of them.
+ * */
+#ifdef RPL_CONF_ANYCAST_DUPLICATES
+#define RPL_ANYCAST_DUPLICATES RPL_CONF_ANYCAST_DUPLICATES
+#else
+#define RPL_ANYCAST_DUPLICATES 8
+#endif
+
 /*
  * RPL probing. When enabled, probes will be sent periodically to keep
  * parent link estimates up to date.
@@ -281,6 +281,10 @@ rpl_set_preferred_parent(rpl_dag_t *dag, rpl_parent_t *p)
 #if MOBIRPL_MOBILITY_DETECTION /* hckim mobirpl */
     mobirpl_set_pp_change_flag(MOBIRPL_PARENT_SWITCH);
 #endif
+
+#ifdef RPL_CALLBACK_PARENT_SWITCH
+    RPL_CALLBACK_PARENT_SWITCH(old, p);
+#endif /* RPL_CALLBACK_PARENT_SWITCH */
   }
 
 #if MOBIRPL_PROACTIVE_DISCOVERY /* hckim mobirpl */
@@ -289,6 +293,10 @@ rpl_set_preferred_parent(rpl_dag_t *dag, rpl_parent_t *p)
   if(dag != NULL && mobirpl_mobility == MOBIRPL_MOBILE_NODE) {
 #endif
 
+    if(dag->preferred_parent == NULL) {
+      /* Parent lost (e.g. nullified): nothing to probe around */
+      mobirpl_set_proactive_discovery_flag(0);
+    } else
 #if MOBIRPL_RH_OF
     if(calculate_flag(dag->preferred_parent) > MOBIRPL_FLAG_2) {
       mobirpl_set_proactive_discovery_flag(1);
@@ -461,6 +469,7 @@ rpl_set_root(uint8_t instance_id, uip_ipaddr_t *dag_id)
   instance->min_hoprankinc = RPL_MIN_HOPRANKINC;
   instance->default_lifetime = RPL_DEFAULT_LIFETIME;
   instance->lifetime_unit = RPL_DEFAULT_LIFETIME_UNIT;
+  instance->rpi_compression = RPL_WITH_RPI_COMPRESSION;
 
   dag->rank = ROOT_RANK(instance);
 
@@ -987,7 +996,11 @@ rpl_select_parent(rpl_dag_t *dag)
      * thus, in rpl_select_dag, current_dag will not be selected as best_dag
      * this will change dag or terminate rpl_select_dag
      */
-    rpl_nullify_parent(dag->preferred_parent);
+    if(dag->preferred_parent != NULL) {
+      rpl_nullify_parent(dag->preferred_parent);
+    } else {
+      dag->rank = INFINITE_RANK;
+    }
 #else
     dag->rank = INFINITE_RANK;
 #endif
@@ -1169,6 +1182,7 @@ rpl_join_instance(uip_ipaddr_t *from, rpl_dio_t *dio)
   instance->dio_redundancy = dio->dag_redund;
   instance->default_lifetime = dio->default_lifetime;
   instance->lifetime_unit = dio->lifetime_unit;
+  instance->rpi_compression = dio->rpi_compression;
 
   memcpy(&dag->dag_id, &dio->dag_id, sizeof(dio->dag_id));
 
@@ -1302,6 +1316,7 @@ global_repair(uip_ipaddr_t *from, rpl_dag_t *dag, rpl_dio_t *dio)
   dag->instance->dio_redundancy = dio->dag_redund;
   dag->instance->default_lifetime = dio->default_lifetime;
   dag->instance->lifetime_unit = dio->lifetime_unit;
+  dag->instance->rpi_compression = dio->rpi_compression;
 
   dag->instance->of->reset(dag);
   dag->min_rank = INFINITE_RANK;
@@ -49,6 +49,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "net/rpl/rpl-private.h"
 #include "net/packetbuf.h"
+#include "lib/crc16.h"
 
 #define DEBUG DEBUG_NONE
 #include "net/ip/uip-debug.h"
@@ -158,6 +159,48 @@ rpl_verify_header(int uip_ext_opt_offset)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_ANYCAST
+/* The upward packets received last, by source address and the CRC of
+   all that follows the hop-by-hop header, which no hop changes */
+static struct {
+  uip_ipaddr_t src;
+  uint16_t crc;
+} anycast_seen[RPL_ANYCAST_DUPLICATES];
+static uint8_t anycast_seen_next;
+
+int
+rpl_anycast_is_duplicate(int uip_ext_opt_offset)
+{
+  uint16_t start, end, crc;
+  int i;
+
+  if(UIP_EXT_HDR_OPT_RPL_BUF->flags & RPL_HDR_OPT_DOWN) {
+    return 0;
+  }
+  start = uip_l2_l3_hdr_len + (UIP_HBHO_BUF->len + 1) * 8;
+  end = UIP_LLH_LEN + uip_len;
+  if(start > end) {
+    return 0;
+  }
+  crc = crc16_data(&uip_buf[start], end - start, 0);
+
+  for(i = 0; i < RPL_ANYCAST_DUPLICATES; i++) {
+    if(anycast_seen[i].crc == crc &&
+       uip_ipaddr_cmp(&anycast_seen[i].src, &UIP_IP_BUF->srcipaddr)) {
+      PRINTF("RPL: Duplicate upward packet from ");
+      PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
+      PRINTF("\n");
+      return 1;
+    }
+  }
+  uip_ipaddr_copy(&anycast_seen[anycast_seen_next].src,
+                  &UIP_IP_BUF->srcipaddr);
+  anycast_seen[anycast_seen_next].crc = crc;
+  anycast_seen_next = (anycast_seen_next + 1) % RPL_ANYCAST_DUPLICATES;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_WITH_ANYCAST */
 static void
 set_rpl_opt(unsigned uip_ext_opt_offset)
 {
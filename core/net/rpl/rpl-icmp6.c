@@ -52,6 +52,7 @@
 #include "net/ipv6/uip-icmp6.h"
 #include "net/rpl/rpl-private.h"
 #include "net/packetbuf.h"
+#include "net/netstack.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 
 #include "sys/node-id.h"
@@ -72,6 +73,10 @@
 #define RPL_DIO_MOP_SHIFT                3
 #define RPL_DIO_MOP_MASK                 0x38
 #define RPL_DIO_PREFERENCE_MASK          0x07
+/* MAC information option: a flags byte, then the log2 of the channel
+   check rate plus one (0 if the radio is not duty cycled) */
+#define RPL_MAC_INFO_LEN                 2
+#define RPL_MAC_INFO_ALWAYS_ON           0x80
 
 #define UIP_IP_BUF       ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
 #define UIP_ICMP_BUF     ((struct uip_icmp_hdr *)&uip_buf[uip_l2_l3_hdr_len])
@@ -94,6 +99,12 @@ static uint16_t dio_tx_num;
 static uint16_t dao_tx_num;
 static uint16_t dao_loop_detected_num;
 
+#if ENERGEST_WITH_CAUSES
+/* Set while handling a DIS, so that the DIOs sent in reply are
+   accounted as responses rather than as trickle DIOs. */
+static uint8_t dis_responding;
+#endif /* ENERGEST_WITH_CAUSES */
+
 /* some debug callbacks useful when debugging RPL networks */
 #ifdef RPL_DEBUG_DIO_INPUT
 void RPL_DEBUG_DIO_INPUT(uip_ipaddr_t *, rpl_dio_t *);
@@ -165,6 +176,24 @@ set16(uint8_t *buffer, int pos, uint16_t value)
   buffer[pos++] = value & 0xff;
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_MAC_INFO
+static uint8_t
+check_rate_log2(void)
+{
+  unsigned short interval;
+  uint8_t log2;
+
+  interval = NETSTACK_RDC.channel_check_interval();
+  if(interval == 0) {
+    return 0;
+  }
+  /* Round the rate down to a power of two; never advertise a rate
+     above the one we use */
+  for(log2 = 1; ((CLOCK_SECOND / interval) >> log2) != 0; log2++);
+  return log2;
+}
+#endif /* RPL_WITH_MAC_INFO */
+/*---------------------------------------------------------------------------*/
 static void
 dis_input(void)
 {
@@ -173,6 +202,10 @@ dis_input(void)
   rpl_instance_t *instance;
   rpl_instance_t *end;
 
+#if ENERGEST_WITH_CAUSES
+  dis_responding = 1;
+#endif /* ENERGEST_WITH_CAUSES */
+
   /* DAG Information Solicitation */
   PRINTF("RPL: Received a DIS from ");
   PRINT6ADDR(&UIP_IP_BUF->srcipaddr);
@@ -242,6 +275,10 @@ reply_proactive_discovery:
 ignore_proactive_discovery:
 #endif
 
+#if ENERGEST_WITH_CAUSES
+  dis_responding = 0;
+#endif /* ENERGEST_WITH_CAUSES */
+
   uip_len = 0;
 }
 /*---------------------------------------------------------------------------*/
@@ -285,6 +322,16 @@ dis_output(uip_ipaddr_t *addr, uint8_t flag)
   printf("r:ds_o|%u|to|%d|f|%u|o|%u|p|%u\n", ++dis_tx_num, LOG_NODEID_FROM_IPADDR(addr), 
       buffer[0], on_demand_dis_tx_num, probing_dis_tx_num);
 
+#if ENERGEST_WITH_CAUSES
+  if(addr != &tmpaddr) {
+    energest_cause_set(ENERGEST_CAUSE_DIS_PROBING);
+  } else if(buffer[0] == 1) {
+    energest_cause_set(ENERGEST_CAUSE_DIS_PROACTIVE);
+  } else {
+    energest_cause_set(ENERGEST_CAUSE_DIS_REACTIVE);
+  }
+#endif /* ENERGEST_WITH_CAUSES */
+
   uip_icmp6_send(addr, ICMP6_RPL, RPL_CODE_DIS, 2);
 }
 /*---------------------------------------------------------------------------*/
@@ -483,6 +530,7 @@ dio_input(void)
       }
 
       /* Path control field not yet implemented - at i + 2 */
+      dio.rpi_compression = (buffer[i + 2] & RPL_DAG_CONF_T_FLAG) != 0;
       dio.dag_intdoubl = buffer[i + 3];
       dio.dag_intmin = buffer[i + 4];
       dio.dag_redund = buffer[i + 5];
@@ -512,12 +560,31 @@ dio_input(void)
       PRINTF("RPL: Copying prefix information\n");
       memcpy(&dio.prefix_info.prefix, &buffer[i + 16], 16);
       break;
+#if RPL_WITH_MAC_INFO
+    case RPL_OPTION_MAC_INFO:
+      if(len < 3) {
+        PRINTF("RPL: Invalid MAC information option, len = %d\n", len);
+        RPL_STAT(rpl_stats.malformed_msgs++);
+        return;
+      }
+      dio.always_on = (buffer[i + 2] & RPL_MAC_INFO_ALWAYS_ON) != 0;
+      if(len >= 2 + RPL_MAC_INFO_LEN && buffer[i + 3] > 0 &&
+         buffer[i + 3] <= 16) {
+        dio.check_rate = 1U << (buffer[i + 3] - 1);
+      }
+      break;
+#endif /* RPL_WITH_MAC_INFO */
     default:
       PRINTF("RPL: Unsupported suboption type in DIO: %u\n",
 	(unsigned)subopt_type);
     }
   }
 
+  /* The MAC needs no wake-up train to reach a neighbor that listens,
+     and a train of one cycle of the neighbor otherwise */
+  nbr->always_on = dio.always_on;
+  nbr->check_rate = dio.check_rate;
+
 #ifdef RPL_DEBUG_DIO_INPUT
   RPL_DEBUG_DIO_INPUT(&from, &dio);
 #endif
@@ -621,7 +688,8 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
   /* Always add a DAG configuration option. */
   buffer[pos++] = RPL_OPTION_DAG_CONF;
   buffer[pos++] = 14;
-  buffer[pos++] = 0; /* No Auth, PCS = 0 */
+  /* No Auth, PCS = 0 */
+  buffer[pos++] = instance->rpi_compression ? RPL_DAG_CONF_T_FLAG : 0;
   buffer[pos++] = instance->dio_intdoubl;
   buffer[pos++] = instance->dio_intmin;
   buffer[pos++] = instance->dio_redundancy;
@@ -637,6 +705,13 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
   set16(buffer, pos, instance->lifetime_unit);
   pos += 2;
 
+#if RPL_WITH_MAC_INFO
+  buffer[pos++] = RPL_OPTION_MAC_INFO;
+  buffer[pos++] = RPL_MAC_INFO_LEN;
+  buffer[pos++] = rpl_get_always_on() ? RPL_MAC_INFO_ALWAYS_ON : 0;
+  buffer[pos++] = check_rate_log2();
+#endif /* RPL_WITH_MAC_INFO */
+
   /* Check if we have a prefix to send also. */
   if(dag->prefix_info.length > 0) {
     buffer[pos++] = RPL_OPTION_PREFIX_INFO;
@@ -662,6 +737,10 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
   printf("r:do_o|%u|to|%d|R|%u\n",
       ++dio_tx_num, LOG_NODEID_FROM_IPADDR(uc_addr), (unsigned)instance->current_dag->rank);
 
+#if ENERGEST_WITH_CAUSES
+  energest_cause_set(uc_addr != NULL || dis_responding ?
+                     ENERGEST_CAUSE_DIO_RESPONSE : ENERGEST_CAUSE_DIO);
+#endif /* ENERGEST_WITH_CAUSES */
 
 #if RPL_LEAF_ONLY
 #if (DEBUG) & DEBUG_PRINT
@@ -861,6 +940,9 @@ dao_input(void)
         printf("r:da_o|%u|to|%u|n|f\n", 
           ++dao_tx_num, LOG_NODEID_FROM_IPADDR(rpl_get_parent_ipaddr(dag->preferred_parent)));
 
+#if ENERGEST_WITH_CAUSES
+        energest_cause_set(ENERGEST_CAUSE_DAO);
+#endif /* ENERGEST_WITH_CAUSES */
         uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
                        ICMP6_RPL, RPL_CODE_DAO, buffer_length);
       }
@@ -923,6 +1005,9 @@ fwd_dao:
       printf("r:da_o|%u|to|%u|p|f\n", 
         ++dao_tx_num, LOG_NODEID_FROM_IPADDR(rpl_get_parent_ipaddr(dag->preferred_parent)));
 
+#if ENERGEST_WITH_CAUSES
+      energest_cause_set(ENERGEST_CAUSE_DAO);
+#endif /* ENERGEST_WITH_CAUSES */
       uip_icmp6_send(rpl_get_parent_ipaddr(dag->preferred_parent),
                      ICMP6_RPL, RPL_CODE_DAO, buffer_length);
     }
@@ -1038,6 +1123,9 @@ dao_output_target(rpl_parent_t *parent, uip_ipaddr_t *prefix, uint8_t lifetime)
   PRINTF("\n");
 
   if(rpl_get_parent_ipaddr(parent) != NULL) {
+#if ENERGEST_WITH_CAUSES
+    energest_cause_set(ENERGEST_CAUSE_DAO);
+#endif /* ENERGEST_WITH_CAUSES */
     uip_icmp6_send(rpl_get_parent_ipaddr(parent), ICMP6_RPL, RPL_CODE_DAO, pos);
   }
 }
@@ -1083,6 +1171,9 @@ dao_ack_output(rpl_instance_t *instance, uip_ipaddr_t *dest, uint8_t sequence)
   buffer[2] = sequence;
   buffer[3] = 0;
 
+#if ENERGEST_WITH_CAUSES
+  energest_cause_set(ENERGEST_CAUSE_DAO);
+#endif /* ENERGEST_WITH_CAUSES */
   uip_icmp6_send(dest, ICMP6_RPL, RPL_CODE_DAO_ACK, 4);
 }
 /*---------------------------------------------------------------------------*/
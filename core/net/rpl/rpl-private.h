@@ -93,6 +93,11 @@ extern uint16_t mobirpl_timeout_period_current;
 #define RPL_OPTION_SOLICITED_INFO        7
 #define RPL_OPTION_PREFIX_INFO           8
 #define RPL_OPTION_TARGET_DESC           9
+/* Not assigned by IANA: how the sender duty cycles its radio, see
+   RPL_WITH_MAC_INFO. Nodes that do not know it skip it. */
+#define RPL_OPTION_MAC_INFO              0xf0
+
+#define RPL_DAG_CONF_T_FLAG              0x20 /* RPI 6LoRH in use */
 
 #define RPL_DAO_K_FLAG                   0x80 /* DAO ACK requested */
 #define RPL_DAO_D_FLAG                   0x40 /* DODAG ID present */
@@ -232,6 +237,9 @@ struct rpl_dio {
   uint8_t dag_redund;
   uint8_t default_lifetime;
   uint16_t lifetime_unit;
+  uint8_t rpi_compression;
+  uint8_t always_on;
+  uint16_t check_rate;
   /* hckim mobirpl */
   int rssi;
   uint8_t mobility;
@@ -320,7 +328,7 @@ void mobirpl_set_proactive_discovery_flag(uint8_t flag);
 #endif
 
 #if MOBIRPL_RH_OF /* hckim mobirpl */
-void mobirpl_rx_callback(rpl_parent_t *parent, int rssi);
+void mobirpl_rx_callback(rpl_parent_t *parent, int16_t rssi);
 #else
 void neighbor_dio_callback_mrhof(rpl_parent_t *parent);
 #endif
@@ -350,6 +358,10 @@ void rpl_reset_periodic_timer(void);
 /* Route poisoning. */
 void rpl_poison_routes(rpl_dag_t *, rpl_parent_t *);
 
+#ifdef RPL_CALLBACK_PARENT_SWITCH
+void RPL_CALLBACK_PARENT_SWITCH(rpl_parent_t *old, rpl_parent_t *new);
+#endif /* RPL_CALLBACK_PARENT_SWITCH */
+
 
 rpl_instance_t *rpl_get_default_instance(void);
 
@@ -44,6 +44,7 @@
 #include "contiki-conf.h"
 #include "net/rpl/rpl-private.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
+#include "net/netstack.h"
 #include "lib/random.h"
 #include "sys/ctimer.h"
 
@@ -82,6 +83,11 @@ static uint16_t mobirpl_proactive_discovery_num;
 /* dio_send_ok is true if the node is ready to send DIOs */
 static uint8_t dio_send_ok;
 
+#if RPL_WITH_MAC_INFO
+/* The channel check interval of the RDC as last advertised in DIOs */
+static unsigned short check_interval;
+#endif /* RPL_WITH_MAC_INFO */
+
 
 /*---------------------------------------------------------------------------*/
 /* hckim mobirpl */
@@ -417,6 +423,17 @@ handle_periodic_timer(void *ptr)
 
   rpl_recalculate_ranks();
 
+#if RPL_WITH_MAC_INFO
+  /* Neighbors strobe for as long as our advertised channel check
+     interval: tell them soon when it changes */
+  if(NETSTACK_RDC.channel_check_interval() != check_interval) {
+    check_interval = NETSTACK_RDC.channel_check_interval();
+    if(default_instance != NULL) {
+      rpl_reset_dio_timer(default_instance);
+    }
+  }
+#endif /* RPL_WITH_MAC_INFO */
+
 #if MOBIRPL_CONNECTIVITY_MANAGEMENT /* hckim mobirpl */
   mobirpl_proactive_discovery();
   /* reactive or periodic discovery */
@@ -568,6 +585,10 @@ rpl_reset_periodic_timer(void)
     ((uint32_t)RPL_DIS_INTERVAL * (uint32_t)random_rand()) / RANDOM_RAND_MAX -
     RPL_DIS_START_DELAY;
 
+#if RPL_WITH_MAC_INFO
+  check_interval = NETSTACK_RDC.channel_check_interval();
+#endif /* RPL_WITH_MAC_INFO */
+
   ctimer_set(&periodic_timer, CLOCK_SECOND, handle_periodic_timer, NULL);
 }
 /*---------------------------------------------------------------------------*/
@@ -66,6 +66,7 @@ uint16_t mobirpl_timeout_period_current = 0;
 /* hckim end */
 
 static enum rpl_mode mode = RPL_MODE_MESH;
+static uint8_t always_on;
 /*---------------------------------------------------------------------------*/
 enum rpl_mode
 rpl_get_mode(void)
@@ -108,6 +109,144 @@ rpl_set_mode(enum rpl_mode m)
 }
 /*---------------------------------------------------------------------------*/
 void
+rpl_set_always_on(uint8_t on)
+{
+  /* Neighbors learn it from the next DIO */
+  always_on = on;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+rpl_get_always_on(void)
+{
+  return always_on;
+}
+/*---------------------------------------------------------------------------*/
+/* hckim mobirpl */
+uint8_t
+mobirpl_is_mobile(void)
+{
+  return mobirpl_mobility == MOBIRPL_MOBILE_NODE;
+}
+/*---------------------------------------------------------------------------*/
+#if RPL_WITH_ANYCAST
+/* hckim mobirpl: a link-layer anycast address stands for the parents
+   that may forward a packet of this node upwards. It has the group bit
+   of the EUI-64 set, carries the rank of the sender and a Bloom filter
+   of the link-layer addresses of those parents. */
+#if LINKADDR_SIZE < 4
+#error "RPL anycast needs link-layer addresses of at least 4 bytes"
+#endif
+#define ANYCAST_ADDR_MARK       0x03
+#define ANYCAST_FILTER_OFFSET   3
+#define ANYCAST_FILTER_BITS     ((LINKADDR_SIZE - ANYCAST_FILTER_OFFSET) * 8)
+
+static uint8_t
+anycast_filter_bits(const linkaddr_t *addr, uint8_t *bit2)
+{
+  uint16_t h;
+  int i;
+
+  h = 0;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    h = h * 31 + addr->u8[i];
+  }
+  *bit2 = (h * 17 + 5) % ANYCAST_FILTER_BITS;
+  return h % ANYCAST_FILTER_BITS;
+}
+/*---------------------------------------------------------------------------*/
+static void
+anycast_filter_add(linkaddr_t *anycast, const linkaddr_t *addr)
+{
+  uint8_t *filter = &anycast->u8[ANYCAST_FILTER_OFFSET];
+  uint8_t bit1, bit2;
+
+  bit1 = anycast_filter_bits(addr, &bit2);
+  filter[bit1 / 8] |= 1 << (bit1 % 8);
+  filter[bit2 / 8] |= 1 << (bit2 % 8);
+}
+/*---------------------------------------------------------------------------*/
+static int
+anycast_filter_contains(const linkaddr_t *anycast, const linkaddr_t *addr)
+{
+  const uint8_t *filter = &anycast->u8[ANYCAST_FILTER_OFFSET];
+  uint8_t bit1, bit2;
+
+  bit1 = anycast_filter_bits(addr, &bit2);
+  return (filter[bit1 / 8] & (1 << (bit1 % 8))) &&
+    (filter[bit2 / 8] & (1 << (bit2 % 8)));
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_anycast_addr(const uip_ipaddr_t *dest, const linkaddr_t *nexthop,
+                 linkaddr_t *addr)
+{
+  rpl_dag_t *dag;
+  rpl_parent_t *p;
+  const linkaddr_t *lladdr;
+  uip_ipaddr_t iid;
+  int count;
+
+  /* Only packets that any parent can forward, i.e., not those for the
+     preferred parent itself, such as DAOs */
+  if(uip_is_addr_linklocal(dest) || uip_is_addr_mcast(dest)) {
+    return 0;
+  }
+  dag = rpl_get_any_dag();
+  if(dag == NULL || dag->preferred_parent == NULL ||
+     dag->rank == INFINITE_RANK) {
+    return 0;
+  }
+  lladdr = (const linkaddr_t *)nbr_table_get_lladdr(rpl_parents,
+                                                    dag->preferred_parent);
+  if(lladdr == NULL || !linkaddr_cmp(lladdr, nexthop)) {
+    return 0;
+  }
+  /* Nor packets addressed to the preferred parent's global address */
+  uip_ds6_set_addr_iid(&iid, (uip_lladdr_t *)lladdr);
+  if(memcmp(&iid.u8[8], &dest->u8[8], 8) == 0) {
+    return 0;
+  }
+
+  memset(addr, 0, sizeof(linkaddr_t));
+  addr->u8[0] = ANYCAST_ADDR_MARK;
+  addr->u8[1] = dag->rank >> 8;
+  addr->u8[2] = dag->rank & 0xff;
+  count = 0;
+  for(p = nbr_table_head(rpl_parents); p != NULL;
+      p = nbr_table_next(rpl_parents, p)) {
+    if(p->dag == dag && p->rank < dag->rank &&
+       p->zone != MOBIRPL_BLACK_ZONE) {
+      anycast_filter_add(addr, (const linkaddr_t *)nbr_table_get_lladdr(rpl_parents, p));
+      count++;
+    }
+  }
+
+  /* With the preferred parent alone, plain unicast does the same */
+  return count > 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+rpl_anycast_is_member(const linkaddr_t *addr)
+{
+  rpl_dag_t *dag;
+  rpl_rank_t sender_rank;
+
+  if(addr->u8[0] != ANYCAST_ADDR_MARK) {
+    return 0;
+  }
+  dag = rpl_get_any_dag();
+  if(dag == NULL || dag->rank == INFINITE_RANK) {
+    return 0;
+  }
+  /* Only nodes closer to the root than the sender, so that no loop
+     forms when the filter matches a node by chance */
+  sender_rank = ((rpl_rank_t)addr->u8[1] << 8) | addr->u8[2];
+  return dag->rank < sender_rank &&
+    anycast_filter_contains(addr, &linkaddr_node_addr);
+}
+#endif /* RPL_WITH_ANYCAST */
+/*---------------------------------------------------------------------------*/
+void
 rpl_purge_routes(void)
 {
   uip_ds6_route_t *r;
@@ -288,6 +427,20 @@ rpl_link_neighbor_callback(const linkaddr_t *addr, int status, int numtx)
   rpl_parent_t *parent;
   rpl_instance_t *instance;
   rpl_instance_t *end;
+#if RPL_WITH_ANYCAST
+  rpl_dag_t *dag;
+
+  /* hckim mobirpl: the ACK of an anycast packet names the parent that
+     took it. Without one, the preferred parent did not take it either. */
+  if(addr->u8[0] == ANYCAST_ADDR_MARK) {
+    dag = rpl_get_any_dag();
+    if(dag == NULL || dag->preferred_parent == NULL) {
+      return;
+    }
+    addr = (const linkaddr_t *)nbr_table_get_lladdr(rpl_parents,
+                                                    dag->preferred_parent);
+  }
+#endif /* RPL_WITH_ANYCAST */
 
   uip_ip6addr(&ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
   uip_ds6_set_addr_iid(&ipaddr, (uip_lladdr_t *)addr);
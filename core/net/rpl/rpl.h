@@ -223,6 +223,8 @@ struct rpl_instance {
   uint8_t dio_intcurrent;
   uint8_t dio_send; /* for keeping track of which mode the timer is in */
   uint8_t dio_counter;
+  /* send the RPL hop-by-hop option as an RPI 6LoRH */
+  uint8_t rpi_compression;
   rpl_rank_t max_rankinc;
   rpl_rank_t min_hoprankinc;
   uint16_t lifetime_unit; /* lifetime in seconds = l_u * d_l */
@@ -253,6 +255,9 @@ rpl_instance_t *rpl_get_instance(uint8_t instance_id);
 int rpl_update_header_empty(void);
 int rpl_update_header_final(uip_ipaddr_t *addr);
 int rpl_verify_header(int);
+#if RPL_WITH_ANYCAST
+int rpl_anycast_is_duplicate(int);
+#endif /* RPL_WITH_ANYCAST */
 void rpl_insert_header(void);
 void rpl_remove_header(void);
 uint8_t rpl_invert_header(void);
@@ -300,6 +305,51 @@ enum rpl_mode rpl_set_mode(enum rpl_mode mode);
  */
 enum rpl_mode rpl_get_mode(void);
 
+/**
+ * Advertise in DIOs that this node keeps its radio on, so that
+ * neighbors can reach it without waking it up first. Needs
+ * RPL_CONF_WITH_MAC_INFO.
+ *
+ * \param on Non-zero if the radio is kept on
+ */
+void rpl_set_always_on(uint8_t on);
+
+/**
+ * Get whether this node advertises that it keeps its radio on
+ */
+uint8_t rpl_get_always_on(void);
+
+/**
+ * Get whether MobiRPL considers this node mobile, e.g. to let it
+ * check the channel at the lowest rate
+ */
+uint8_t mobirpl_is_mobile(void);
+
+#if RPL_WITH_ANYCAST
+/**
+ * Get a link-layer anycast address that reaches any parent that can
+ * forward a packet upwards in place of the preferred parent, e.g., as
+ * SICSLOWPAN_CONF_ANYCAST_ADDR. Parents in the black zone or with a
+ * rank not lower than ours are left out.
+ *
+ * \param dest The IPv6 destination of the packet
+ * \param nexthop The link-layer next hop of the packet
+ * \param addr Where to put the anycast address
+ * \retval Non-zero if addr was set, zero to send to nexthop
+ */
+int rpl_anycast_addr(const uip_ipaddr_t *dest, const linkaddr_t *nexthop,
+                     linkaddr_t *addr);
+
+/**
+ * Check whether this node takes packets sent to a link-layer anycast
+ * address, e.g., as CONTIKIMAC_CONF_ANYCAST_IS_MEMBER
+ *
+ * \param addr The link-layer destination of a frame
+ * \retval Non-zero if this node is one of the parents addr stands for
+ */
+int rpl_anycast_is_member(const linkaddr_t *addr);
+#endif /* RPL_WITH_ANYCAST */
+
 /* hckim mobirpl */
 enum mobirpl_pp_change_flag {
   MOBIRPL_NO_PARENT_SWITCH = 0,
@@ -92,6 +92,9 @@ ctimer_init(void)
 {
   initialized = 0;
   list_init(ctimer_list);
+  /* Callback timers drive the MAC and routing layers, so their
+     expirations are delivered ahead of application events. */
+  ctimer_process.priority = PROCESS_PRIORITY_HIGH;
   process_start(&ctimer_process, NULL);
 }
 /*---------------------------------------------------------------------------*/
@@ -50,6 +50,12 @@ energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVICE_LEVE
 #endif
 unsigned char energest_current_mode[ENERGEST_TYPE_MAX];
 
+#if ENERGEST_WITH_CAUSES
+static energest_t energest_cause_transmit[ENERGEST_CAUSE_MAX];
+static energest_t energest_cause_listen[ENERGEST_CAUSE_MAX];
+static unsigned char energest_pending_cause;
+#endif /* ENERGEST_WITH_CAUSES */
+
 /*---------------------------------------------------------------------------*/
 void
 energest_init(void)
@@ -64,6 +70,12 @@ energest_init(void)
     energest_leveldevice_current_leveltime[i].current = 0;
   }
 #endif
+#if ENERGEST_WITH_CAUSES
+  for(i = 0; i < ENERGEST_CAUSE_MAX; ++i) {
+    energest_cause_transmit[i].current = energest_cause_listen[i].current = 0;
+  }
+  energest_pending_cause = ENERGEST_CAUSE_DATA;
+#endif /* ENERGEST_WITH_CAUSES */
 }
 /*---------------------------------------------------------------------------*/
 unsigned long
@@ -72,7 +84,7 @@ energest_type_time(int type)
   /* Note: does not support ENERGEST_CONF_LEVELDEVICE_LEVELS! */
 #ifndef ENERGEST_CONF_LEVELDEVICE_LEVELS
   if(energest_current_mode[type]) {
-    rtimer_clock_t now = RTIMER_NOW();
+    rtimer_clock_t now = ENERGEST_CURRENT_TIME();
     energest_total_time[type].current += (rtimer_clock_t)
       (now - energest_current_time[type]);
     energest_current_time[type] = now;
@@ -105,7 +117,7 @@ energest_flush(void)
   int i;
   for(i = 0; i < ENERGEST_TYPE_MAX; i++) {
     if(energest_current_mode[i]) {
-      now = RTIMER_NOW();
+      now = ENERGEST_CURRENT_TIME();
       energest_total_time[i].current += (rtimer_clock_t)
 	(now - energest_current_time[i]);
       energest_current_time[i] = now;
@@ -113,9 +125,62 @@ energest_flush(void)
   }
 }
 /*---------------------------------------------------------------------------*/
+#if ENERGEST_WITH_CAUSES
+/* Tags the next packet handed to the network stack with a cause. The
+   tag is consumed by energest_cause_next() and falls back to
+   ENERGEST_CAUSE_DATA for all packets that are not tagged. */
+void
+energest_cause_set(int cause)
+{
+  if(cause >= 0 && cause < ENERGEST_CAUSE_MAX) {
+    energest_pending_cause = cause;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+energest_cause_next(void)
+{
+  int cause = energest_pending_cause;
+  energest_pending_cause = ENERGEST_CAUSE_DATA;
+  return cause;
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_cause_add(int cause, unsigned long transmit, unsigned long listen)
+{
+  if(cause >= 0 && cause < ENERGEST_CAUSE_MAX) {
+    energest_cause_transmit[cause].current += transmit;
+    energest_cause_listen[cause].current += listen;
+  }
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+energest_cause_time(int cause, int type)
+{
+  if(cause < 0 || cause >= ENERGEST_CAUSE_MAX) {
+    return 0;
+  }
+  if(type == ENERGEST_TYPE_TRANSMIT) {
+    return energest_cause_transmit[cause].current;
+  } else if(type == ENERGEST_TYPE_LISTEN) {
+    return energest_cause_listen[cause].current;
+  }
+  return 0;
+}
+#else /* ENERGEST_WITH_CAUSES */
+void energest_cause_set(int cause) {}
+int energest_cause_next(void) { return ENERGEST_CAUSE_DATA; }
+void energest_cause_add(int cause, unsigned long transmit, unsigned long listen) {}
+unsigned long energest_cause_time(int cause, int type) { return 0; }
+#endif /* ENERGEST_WITH_CAUSES */
+/*---------------------------------------------------------------------------*/
 #else /* ENERGEST_CONF_ON */
 void energest_type_set(int type, unsigned long val) {}
 void energest_init(void) {}
 unsigned long energest_type_time(int type) { return 0; }
 void energest_flush(void) {}
+void energest_cause_set(int cause) {}
+int energest_cause_next(void) { return ENERGEST_CAUSE_DATA; }
+void energest_cause_add(int cause, unsigned long transmit, unsigned long listen) {}
+unsigned long energest_cause_time(int cause, int type) { return 0; }
 #endif /* ENERGEST_CONF_ON */
@@ -67,6 +67,28 @@ enum energest_type {
   ENERGEST_TYPE_MAX
 };
 
+/* Per-cause accounting of the radio time spent on sending packets.
+   The cause is tagged on the outgoing packet (see
+   PACKETBUF_ATTR_ENERGEST_CAUSE) and the RDC layer adds the transmit
+   and listen time of every transmission attempt to it. */
+#ifdef ENERGEST_CONF_WITH_CAUSES
+#define ENERGEST_WITH_CAUSES ENERGEST_CONF_WITH_CAUSES
+#else
+#define ENERGEST_WITH_CAUSES 0
+#endif
+
+enum energest_cause {
+  ENERGEST_CAUSE_DATA,
+  ENERGEST_CAUSE_DIO,
+  ENERGEST_CAUSE_DIO_RESPONSE,
+  ENERGEST_CAUSE_DIS_REACTIVE,
+  ENERGEST_CAUSE_DIS_PROACTIVE,
+  ENERGEST_CAUSE_DIS_PROBING,
+  ENERGEST_CAUSE_DAO,
+
+  ENERGEST_CAUSE_MAX
+};
+
 void energest_init(void);
 unsigned long energest_type_time(int type);
 #ifdef ENERGEST_CONF_LEVELDEVICE_LEVELS
@@ -75,6 +97,19 @@ unsigned long energest_leveldevice_leveltime(int powerlevel);
 void energest_type_set(int type, unsigned long value);
 void energest_flush(void);
 
+void energest_cause_set(int cause);
+int energest_cause_next(void);
+void energest_cause_add(int cause, unsigned long transmit, unsigned long listen);
+unsigned long energest_cause_time(int cause, int type);
+
+/* The time source of energest. Platforms where RTIMER_NOW() has side
+   effects can provide one that has none. */
+#ifdef ENERGEST_CONF_CURRENT_TIME
+#define ENERGEST_CURRENT_TIME ENERGEST_CONF_CURRENT_TIME
+#else /* ENERGEST_CONF_CURRENT_TIME */
+#define ENERGEST_CURRENT_TIME RTIMER_NOW
+#endif /* ENERGEST_CONF_CURRENT_TIME */
+
 #if ENERGEST_CONF_ON
 /*extern int energest_total_count;*/
 extern energest_t energest_total_time[ENERGEST_TYPE_MAX];
@@ -87,33 +122,33 @@ extern energest_t energest_leveldevice_current_leveltime[ENERGEST_CONF_LEVELDEVI
 
 #define ENERGEST_ON(type)  do { \
                            /*++energest_total_count;*/ \
-                           energest_current_time[type] = RTIMER_NOW(); \
+                           energest_current_time[type] = ENERGEST_CURRENT_TIME(); \
 			   energest_current_mode[type] = 1; \
                            } while(0)
 #ifdef __AVR__
 /* Handle 16 bit rtimer wraparound */
 #define ENERGEST_OFF(type) if(energest_current_mode[type] != 0) do {	\
-							if (RTIMER_NOW() < energest_current_time[type]) energest_total_time[type].current += RTIMER_ARCH_SECOND; \
-							energest_total_time[type].current += (rtimer_clock_t)(RTIMER_NOW() - \
+							if (ENERGEST_CURRENT_TIME() < energest_current_time[type]) energest_total_time[type].current += RTIMER_ARCH_SECOND; \
+							energest_total_time[type].current += (rtimer_clock_t)(ENERGEST_CURRENT_TIME() - \
 							energest_current_time[type]); \
 							energest_current_mode[type] = 0; \
                            } while(0)
 
 #define ENERGEST_OFF_LEVEL(type,level) do { \
-										if (RTIMER_NOW() < energest_current_time[type]) energest_total_time[type].current += RTIMER_ARCH_SECOND; \
-										energest_leveldevice_current_leveltime[level].current += (rtimer_clock_t)(RTIMER_NOW() - \
+										if (ENERGEST_CURRENT_TIME() < energest_current_time[type]) energest_total_time[type].current += RTIMER_ARCH_SECOND; \
+										energest_leveldevice_current_leveltime[level].current += (rtimer_clock_t)(ENERGEST_CURRENT_TIME() - \
 										energest_current_time[type]); \
 										energest_current_mode[type] = 0; \
                                        } while(0)
 #else
 #define ENERGEST_OFF(type) if(energest_current_mode[type] != 0) do {	\
-                           energest_total_time[type].current += (rtimer_clock_t)(RTIMER_NOW() - \
+                           energest_total_time[type].current += (rtimer_clock_t)(ENERGEST_CURRENT_TIME() - \
                            energest_current_time[type]); \
 			   energest_current_mode[type] = 0; \
                            } while(0)
 
 #define ENERGEST_OFF_LEVEL(type,level) do { \
-                                        energest_leveldevice_current_leveltime[level].current += (rtimer_clock_t)(RTIMER_NOW() - \
+                                        energest_leveldevice_current_leveltime[level].current += (rtimer_clock_t)(ENERGEST_CURRENT_TIME() - \
 			                energest_current_time[type]); \
 			   energest_current_mode[type] = 0; \
                                         } while(0)
@@ -49,6 +49,9 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
+/* The list is kept sorted by expiration time, so the next timer to
+   expire is always at the head. This is a plain sorted list: adding
+   a timer walks the list to its position. */
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
@@ -57,29 +60,73 @@ PROCESS(etimer_process, "Event timer");
 static void
 update_time(void)
 {
-  clock_time_t tdist;
-  clock_time_t now;
-  struct etimer *t;
-
   if (timerlist == NULL) {
     next_expiration = 0;
   } else {
-    now = clock_time();
-    t = timerlist;
-    /* Must calculate distance to next time into account due to wraps */
-    tdist = t->timer.start + t->timer.interval - now;
-    for(t = t->next; t != NULL; t = t->next) {
-      if(t->timer.start + t->timer.interval - now < tdist) {
-	tdist = t->timer.start + t->timer.interval - now;
-      }
+    next_expiration = timerlist->timer.start + timerlist->timer.interval;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Time left until t expires, or 0 if it already has. Unlike the raw
+   expiration time, this orders timers correctly across clock wraps. */
+static clock_time_t
+time_left(struct etimer *t, clock_time_t now)
+{
+  clock_time_t elapsed = now - t->timer.start;
+
+  if(elapsed >= t->timer.interval) {
+    return 0;
+  }
+  return t->timer.interval - elapsed;
+}
+/*---------------------------------------------------------------------------*/
+static void
+insert_timer(struct etimer *timer)
+{
+  struct etimer *t, *u;
+  clock_time_t now, left;
+
+  now = clock_time();
+  left = time_left(timer, now);
+
+  /* Timers with equal expiration times stay in the order they were
+     added. */
+  u = NULL;
+  for(t = timerlist; t != NULL && time_left(t, now) <= left; t = t->next) {
+    u = t;
+  }
+
+  timer->next = t;
+  if(u != NULL) {
+    u->next = timer;
+  } else {
+    timerlist = timer;
+    update_time();
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+remove_timer(struct etimer *timer)
+{
+  struct etimer *t;
+
+  if(timer == timerlist) {
+    timerlist = timerlist->next;
+    update_time();
+  } else {
+    for(t = timerlist; t != NULL && t->next != timer; t = t->next);
+    if(t == NULL) {
+      return 0;
     }
-    next_expiration = now + tdist;
+    t->next = timer->next;
   }
+  timer->next = NULL;
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(etimer_process, ev, data)
 {
-  struct etimer *t, *u;
+  struct etimer *t;
 	
   PROCESS_BEGIN();
 
@@ -104,38 +151,30 @@ PROCESS_THREAD(etimer_process, ev, data)
 	    t = t->next;
 	}
       }
+      update_time();
       continue;
     } else if(ev != PROCESS_EVENT_POLL) {
       continue;
     }
 
-  again:
-    
-    u = NULL;
-    
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(timer_expired(&t->timer)) {
-	if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
-	  
-	  /* Reset the process ID of the event timer, to signal that the
-	     etimer has expired. This is later checked in the
-	     etimer_expired() function. */
-	  t->p = PROCESS_NONE;
-	  if(u != NULL) {
-	    u->next = t->next;
-	  } else {
-	    timerlist = t->next;
-	  }
-	  t->next = NULL;
-	  update_time();
-	  goto again;
-	} else {
-	  etimer_request_poll();
-	}
+    /* Only the head of the list needs to be checked: once a timer
+       has not expired, none of the ones after it have either. */
+    while(timerlist != NULL && timer_expired(&timerlist->timer)) {
+      t = timerlist;
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+
+	/* Reset the process ID of the event timer, to signal that the
+	   etimer has expired. This is later checked in the
+	   etimer_expired() function. */
+	t->p = PROCESS_NONE;
+	timerlist = t->next;
+	t->next = NULL;
+	update_time();
+      } else {
+	etimer_request_poll();
+	break;
       }
-      u = t;
     }
-    
   }
   
   PROCESS_END();
@@ -150,27 +189,16 @@ etimer_request_poll(void)
 static void
 add_timer(struct etimer *timer)
 {
-  struct etimer *t;
-
   etimer_request_poll();
 
   if(timer->p != PROCESS_NONE) {
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(t == timer) {
-	/* Timer already on list, bail out. */
-        timer->p = PROCESS_CURRENT();
-	update_time();
-	return;
-      }
-    }
+    /* The timer may already be on the list, but its expiration time
+       has changed, so it has to be moved to its new position. */
+    remove_timer(timer);
   }
 
-  /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
-  timer->next = timerlist;
-  timerlist = timer;
-
-  update_time();
+  insert_timer(timer);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -198,7 +226,9 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
-  update_time();
+  if(et->p != PROCESS_NONE && remove_timer(et)) {
+    insert_timer(et);
+  }
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -234,26 +264,7 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
-  struct etimer *t;
-
-  /* First check if et is the first event timer on the list. */
-  if(et == timerlist) {
-    timerlist = timerlist->next;
-    update_time();
-  } else {
-    /* Else walk through the list and try to find the item before the
-       et timer. */
-    for(t = timerlist; t != NULL && t->next != et; t = t->next);
-
-    if(t != NULL) {
-      /* We've found the item before the event timer that we are about
-	 to remove. We point the items next pointer to the event after
-	 the removed item. */
-      t->next = et->next;
-
-      update_time();
-    }
-  }
+  remove_timer(et);
 
   /* Remove the next pointer from the item to be removed. */
   et->next = NULL;
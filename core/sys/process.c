@@ -65,11 +65,32 @@ struct event_data {
   struct process *p;
 };
 
-static process_num_events_t nevents, fevent;
+/*
+ * One ring buffer of events per priority class. The high priority
+ * queue is always emptied first.
+ */
+struct event_queue {
+  process_num_events_t nevents, fevent;
+  process_num_events_t size;
+  struct event_data *events;
+};
+
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
+static struct event_data events_high[PROCESS_CONF_NUMEVENTS_HIGH];
+static struct event_queue queues[PROCESS_PRIORITIES] = {
+  { 0, 0, PROCESS_CONF_NUMEVENTS, events },
+  { 0, 0, PROCESS_CONF_NUMEVENTS_HIGH, events_high },
+};
+
+/* Total number of queued events, in all classes. */
+static process_num_events_t nevents;
+/* Events for high priority processes waiting in the normal queue
+   because the high priority queue was full. */
+static process_num_events_t nspilled;
 
 #if PROCESS_CONF_STATS
-process_num_events_t process_maxevents;
+process_num_events_t process_maxevents[PROCESS_PRIORITIES];
+unsigned short process_dropped_events[PROCESS_PRIORITIES];
 #endif
 
 static volatile unsigned char poll_requested;
@@ -207,12 +228,19 @@ process_exit(struct process *p)
 void
 process_init(void)
 {
+  int i;
+
   lastevent = PROCESS_EVENT_MAX;
 
-  nevents = fevent = 0;
+  nevents = 0;
+  nspilled = 0;
+  for(i = 0; i < PROCESS_PRIORITIES; i++) {
+    queues[i].nevents = queues[i].fevent = 0;
 #if PROCESS_CONF_STATS
-  process_maxevents = 0;
+    process_maxevents[i] = 0;
+    process_dropped_events[i] = 0;
 #endif /* PROCESS_CONF_STATS */
+  }
 
   process_current = process_list = NULL;
 }
@@ -249,6 +277,7 @@ do_event(void)
   static process_data_t data;
   static struct process *receiver;
   static struct process *p;
+  static struct event_queue *q;
   
   /*
    * If there are any events in the queue, take the first one and walk
@@ -259,17 +288,29 @@ do_event(void)
    */
 
   if(nevents > 0) {
+
+    /* Events for high priority processes go first. */
+    q = &queues[PROCESS_PRIORITY_HIGH];
+    if(q->nevents == 0) {
+      q = &queues[PROCESS_PRIORITY_NORMAL];
+    }
     
     /* There are events that we should deliver. */
-    ev = events[fevent].ev;
+    ev = q->events[q->fevent].ev;
     
-    data = events[fevent].data;
-    receiver = events[fevent].p;
+    data = q->events[q->fevent].data;
+    receiver = q->events[q->fevent].p;
 
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    q->fevent = (q->fevent + 1) % q->size;
+    --q->nevents;
     --nevents;
+    if(q == &queues[PROCESS_PRIORITY_NORMAL] &&
+       receiver != PROCESS_BROADCAST &&
+       receiver->priority == PROCESS_PRIORITY_HIGH) {
+      --nspilled;
+    }
 
     /* If this is a broadcast event, we deliver it to all events, in
        order of their priority. */
@@ -301,13 +342,23 @@ do_event(void)
 int
 process_run(void)
 {
+  process_num_events_t n;
+
   /* Process poll events. */
   if(poll_requested) {
     do_poll();
   }
 
-  /* Process one event from the queue */
-  do_event();
+  /* Deliver as many events as were queued when this pass started, so
+     that a process posting to itself cannot starve the caller. High
+     priority events posted meanwhile still go first, and events the
+     caller posts between calls wait for the whole batch. */
+  for(n = nevents; n > 0; n--) {
+    do_event();
+    if(poll_requested) {
+      do_poll();
+    }
+  }
 
   return nevents + poll_requested;
 }
@@ -322,6 +373,8 @@ int
 process_post(struct process *p, process_event_t ev, process_data_t data)
 {
   static process_num_events_t snum;
+  static struct event_queue *q;
+  unsigned char priority;
 
   if(PROCESS_CURRENT() == NULL) {
     PRINTF("process_post: NULL process posts event %d to process '%s', nevents %d\n",
@@ -331,8 +384,28 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
 	   PROCESS_NAME_STRING(PROCESS_CURRENT()), ev,
 	   p == PROCESS_BROADCAST? "<broadcast>": PROCESS_NAME_STRING(p), nevents);
   }
+
+  priority = PROCESS_PRIORITY_NORMAL;
+  if(p != PROCESS_BROADCAST && p->priority == PROCESS_PRIORITY_HIGH) {
+    priority = PROCESS_PRIORITY_HIGH;
+  }
+
+  /* A full high priority queue overflows into the normal one rather
+     than dropping the event. Later high priority events follow the
+     spilled ones there until those are delivered, so that no process
+     gets its events out of order. */
+  q = &queues[priority];
+  if(priority == PROCESS_PRIORITY_HIGH &&
+     (q->nevents == q->size || nspilled > 0)) {
+    q = &queues[PROCESS_PRIORITY_NORMAL];
+  }
   
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  if(q->nevents == q->size) {
+#if PROCESS_CONF_STATS
+    if(process_dropped_events[q - queues] < 0xffff) {
+      process_dropped_events[q - queues]++;
+    }
+#endif /* PROCESS_CONF_STATS */
 #if DEBUG
     if(p == PROCESS_BROADCAST) {
       printf("soft panic: event queue is full when broadcast event %d was posted from %s\n", ev, PROCESS_NAME_STRING(process_current));
@@ -343,15 +416,20 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
     return PROCESS_ERR_FULL;
   }
   
-  snum = (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+  snum = (process_num_events_t)(q->fevent + q->nevents) % q->size;
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
   ++nevents;
+  if(priority == PROCESS_PRIORITY_HIGH &&
+     q == &queues[PROCESS_PRIORITY_NORMAL]) {
+    ++nspilled;
+  }
 
 #if PROCESS_CONF_STATS
-  if(nevents > process_maxevents) {
-    process_maxevents = nevents;
+  if(q->nevents > process_maxevents[q - queues]) {
+    process_maxevents[q - queues] = q->nevents;
   }
 #endif /* PROCESS_CONF_STATS */
   
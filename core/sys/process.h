@@ -88,6 +88,27 @@ typedef unsigned char process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/* Size of the separate queue for events posted to high priority
+   processes. When it is full, such events go to the normal queue,
+   and so do later ones until those have been delivered. */
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 8
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+/**
+ * \name Process priorities
+ *
+ * Events posted to a process with PROCESS_PRIORITY_HIGH are
+ * delivered before any pending event for a PROCESS_PRIORITY_NORMAL
+ * process. Processes are normal priority unless their priority field
+ * is set before they are started.
+ * @{
+ */
+#define PROCESS_PRIORITY_NORMAL 0
+#define PROCESS_PRIORITY_HIGH   1
+#define PROCESS_PRIORITIES      2
+/* @} */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -322,7 +343,7 @@ struct process {
 #endif
   PT_THREAD((* thread)(struct pt *, process_event_t, process_data_t));
   struct pt pt;
-  unsigned char state, needspoll;
+  unsigned char state, needspoll, priority;
 };
 
 /**
@@ -469,6 +490,20 @@ CCIF process_event_t process_alloc_event(void);
  */
 CCIF void process_poll(struct process *p);
 
+#if PROCESS_CONF_STATS
+/**
+ * Highest number of events that have been queued at once, per
+ * priority class.
+ */
+extern process_num_events_t process_maxevents[PROCESS_PRIORITIES];
+
+/**
+ * Number of events that could not be posted, per event queue that
+ * was full.
+ */
+extern unsigned short process_dropped_events[PROCESS_PRIORITIES];
+#endif /* PROCESS_CONF_STATS */
+
 /** @} */
 
 /**
@@ -485,11 +520,12 @@ CCIF void process_poll(struct process *p);
 void process_init(void);
 
 /**
- * Run the system once - call poll handlers and process one event.
+ * Run the system once - call poll handlers and process a batch of events.
  *
  * This function should be called repeatedly from the main() program
  * to actually run the Contiki system. It calls the necessary poll
- * handlers, and processes one event. The function returns the number
+ * handlers, and processes as many events as were queued when it was
+ * called, high priority events first. The function returns the number
  * of events that are waiting in the event queue so that the caller
  * may choose to put the CPU to sleep when there are no pending
  * events.
@@ -3,10 +3,17 @@
 
 #include "sys/node-id.h"
 
-/* evaluation setting */
+/* evaluation setting, may be selected from the command line
+   (e.g. tools/mobirpl-sim) */
+#ifndef TESTBED_EVAL
 #define TESTBED_EVAL                        0
+#endif
+#ifndef COOJA_EVAL
 #define COOJA_EVAL                          0
+#endif
+#ifndef COOJA_EVAL_2
 #define COOJA_EVAL_2                        1
+#endif
 
 #if TESTBED_EVAL
 /* topology */
@@ -38,7 +45,9 @@
 #define SINGLE_SENDER_ID                    MAX_NODES
 /* app layer */
 #define UPWARD_TRAFFIC                      1
+#ifndef DOWNWARD_TRAFFIC
 #define DOWNWARD_TRAFFIC    				0
+#endif
 #define APP_MAX_SEQNO                       200 /* 1000, 200 */
 #define CONF_START_DELAY                    30 /* Cooja: 30, Testbed: 180 */
 #define CONF_SEND_INTERVAL                  30 /* 6, 30 */
@@ -70,6 +79,11 @@
 #define CC2420_CONF_RF_POWER		    	31 /* Cooja: 31, testbed: 11 */
 /* cooja end */
 #endif
+/* extra app payload bytes, e.g. to make packets span two 6lowpan
+   fragments */
+#ifndef APP_PAYLOAD_PADDING
+#define APP_PAYLOAD_PADDING                 0
+#endif
 
 
 /* ipv6 layer */
@@ -77,6 +91,8 @@
 #define NBR_TABLE_CONF_MAX_NEIGHBORS        MAX_MEMORIES
 #undef UIP_CONF_MAX_ROUTES
 #define UIP_CONF_MAX_ROUTES                 MAX_MEMORIES
+/* 6lowpan: reassemble from two senders at once */
+#define SICSLOWPAN_CONF_REASS_CONTEXTS      2
 
 /* rpl layer */
 #define RPL_CONF_WITH_PROBING               0
@@ -84,10 +100,20 @@
 #define RPL_CONF_DIO_INTERVAL_DOUBLINGS     8  /*  8, 2 */
 
 
-/* mobirpl - operations */
+/* mobirpl - operations, may be selected from the command line
+   (e.g. regression-tests/21-mobirpl) */
+#ifndef MOBIRPL_MOBILITY_DETECTION
 #define MOBIRPL_MOBILITY_DETECTION          0
+#endif
+#ifndef MOBIRPL_CONNECTIVITY_MANAGEMENT
 #define MOBIRPL_CONNECTIVITY_MANAGEMENT     0
+#endif
+#ifndef MOBIRPL_RH_OF
 #define MOBIRPL_RH_OF 					    0
+#endif
+#ifndef MOBIRPL_TSCH
+#define MOBIRPL_TSCH                        0 /* tsch instead of contikimac */
+#endif
 #if MOBIRPL_CONNECTIVITY_MANAGEMENT
 #define MOBIRPL_NULLIFY	                    1
 #define MOBIRPL_UNICAST_PROBING             1
@@ -130,22 +156,73 @@
 #define SICSLOWPAN_CONF_MAX_MAC_TRANSMISSIONS       5 /* max retx: 5 in default */
 
 /* rdc layer */
+/* software acks carry the receiver-measured rssi/lqi of the data
+   frame, so rh-of sees the forward link (contikimac sw acks, nullrdc) */
+#ifndef MOBIRPL_ACK_FEEDBACK
+#define MOBIRPL_ACK_FEEDBACK                        0
+#endif
+#if MOBIRPL_ACK_FEEDBACK
+#define RDC_CONF_WITH_ACK_FEEDBACK                  1
+#endif
 #if ALWAYS_ON_RDC
 #undef NETSTACK_CONF_RDC
 #define NETSTACK_CONF_RDC nullrdc_driver
 #define NULLRDC_CONF_802154_AUTOACK                 1
+#elif MOBIRPL_TSCH
+/* tsch: slots sized for the cooja radio (1 ms rtimer ticks, 2 ms tx
+   turnaround), the rpl parent is the time source */
+#undef NETSTACK_CONF_RDC
+#define NETSTACK_CONF_RDC tsch_driver
+#define TSCH_CONF_SLOT_DURATION                     15
+#define TSCH_CONF_TX_OFFSET                         3
+#define TSCH_CONF_RX_DELAY                          2
+#define TSCH_CONF_GUARD_TIME                        2
+#define TSCH_CONF_ACK_WAIT                          3
+#define TSCH_CONF_EB_PERIOD                         (4 * CLOCK_SECOND)
+#define TSCH_CONF_CALLBACK_JOINING_NETWORK          tsch_rpl_callback_joining_network
+#define TSCH_CONF_CALLBACK_LEAVING_NETWORK          tsch_rpl_callback_leaving_network
+#define RPL_CONF_CALLBACK_PARENT_SWITCH             tsch_rpl_callback_parent_switch
 #else
 #undef NETSTACK_CONF_RDC
 #define NETSTACK_CONF_RDC contikimac_driver
-#define REMOVE_STROBE_FROM_ONE_HOP_NODE_TO_SINK     0
+#define CONTIKIMAC_CONF_WITH_ALWAYS_ON_NEIGHBORS    0
 #undef NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE
 #define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE        32 /* 8, 16 */
+#if MOBIRPL_CONNECTIVITY_MANAGEMENT
+/* forget the wake-up phase of a parent once its link counts as lost */
+#define PHASE_CONF_MAX_NOACKS                       (LINK_LOSS_THRESHOLD * SICSLOWPAN_CONF_MAX_MAC_TRANSMISSIONS)
+#endif
+/* per-node channel check rate: idle and mobile nodes slow down */
+#ifndef CONTIKIMAC_CONF_WITH_ADAPTIVE_CHECK_RATE
+#define CONTIKIMAC_CONF_WITH_ADAPTIVE_CHECK_RATE    0
+#endif
+#if CONTIKIMAC_CONF_WITH_ADAPTIVE_CHECK_RATE
+#define RPL_CONF_WITH_MAC_INFO                      1 /* advertise the rate */
+#endif
+#define CONTIKIMAC_CONF_MIN_CHANNEL_CHECK_RATE      16
+#define CONTIKIMAC_CONF_MAX_CHANNEL_CHECK_RATE      32
+#define CONTIKIMAC_CONF_PREFER_LOW_CHECK_RATE       mobirpl_is_mobile
+/* anycast upward packets to whichever acceptable parent wakes up first */
+#ifndef MOBIRPL_ANYCAST
+#define MOBIRPL_ANYCAST                             0
+#endif
+#if MOBIRPL_ANYCAST
+#define SICSLOWPAN_CONF_ANYCAST_ADDR                rpl_anycast_addr
+#define CONTIKIMAC_CONF_ANYCAST_IS_MEMBER           rpl_anycast_is_member
+#define RPL_CONF_WITH_ANYCAST                       1
+#define COOJA_RADIO_CONF_ACK_BY_FRAME_TYPE          1
+#endif
 #endif
 
 /* phy layer */
 #define RF_CHANNEL  						26
 #undef CC2420_CONF_CCA_THRESH
 #define CC2420_CONF_CCA_THRESH  			-42 /* -45 + 3 -> -87 */
+/* cooja motes use the MAC addresses of the Sky motes: 00:..:00:<node id> */
+#define COOJA_CONF_NODE_ID_MAC_ADDRESS      1
+
+/* energest */
+#define ENERGEST_CONF_WITH_CAUSES           1 /* per-cause radio time: data, dio, dis, dao */
 
 /* log */
 #define LOG_MAGIC 0xcafebabe
@@ -62,6 +62,9 @@ struct app_data {
   uint8_t hop;
   uint8_t ping;
   uint16_t dummy_for_padding;
+#if APP_PAYLOAD_PADDING
+  uint8_t padding[APP_PAYLOAD_PADDING];
+#endif
 };
 
 static uint16_t app_tx_num;
@@ -103,8 +106,10 @@ simple_energest_step(int verbose)
   last_time = curr_time;
 
   if(verbose) {
-    uint32_t fraction = (1000ul * (delta_tx + delta_rx)) / delta_time;
-    uint32_t all_fraction = (1000ul * (curr_tx + curr_rx)) / curr_time;
+    uint32_t fraction = delta_time == 0 ? 0 :
+      (1000ul * (delta_tx + delta_rx)) / delta_time;
+    uint32_t all_fraction = curr_time == 0 ? 0 :
+      (1000ul * (curr_tx + curr_rx)) / curr_time;
     printf("dc:[%u %u]|%8lu|+|%8lu|/|%8lu|(%lu|permil)|%lu\n",
         node_id,
         energest_cnt++,
@@ -112,6 +117,19 @@ simple_energest_step(int verbose)
         fraction,
         all_fraction
         );
+#if ENERGEST_WITH_CAUSES
+    /* cumulative tx+rx radio time per cause, in the order of
+       enum energest_cause: data|dio|dio resp|reactive dis|proactive dis|probing dis|dao */
+    {
+      int i;
+      printf("dc:c|%u|%u", node_id, energest_cnt - 1);
+      for(i = 0; i < ENERGEST_CAUSE_MAX; i++) {
+        printf("|%lu", energest_cause_time(i, ENERGEST_TYPE_TRANSMIT) +
+                       energest_cause_time(i, ENERGEST_TYPE_LISTEN));
+      }
+      printf("\n");
+    }
+#endif
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -173,12 +191,16 @@ app_send_to(uint16_t id, uint32_t seqno)
   data.src = UIP_HTONS(node_id);
   data.dest = UIP_HTONS(id);
   data.hop = 0;
+#if APP_PAYLOAD_PADDING
+  memset(data.padding, 0, sizeof(data.padding));
+#endif
 
   rpl_dag_t *dag = rpl_get_any_dag();
 
   printf("a:txu|%u|t|%u|s|%lx|h|%u\n", ++app_tx_num, id, 
     (unsigned long)UIP_HTONL(data.seqno),
-    DAG_RANK(dag->preferred_parent->rank, dag->instance));
+    dag != NULL && dag->preferred_parent != NULL ?
+    DAG_RANK(dag->preferred_parent->rank, dag->instance) : 0);
 
   uip_udp_packet_sendto(client_conn, &data, sizeof(data),
           &server_ipaddr, UIP_HTONS(UDP_SERVER_PORT));
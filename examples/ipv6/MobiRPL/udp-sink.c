@@ -40,6 +40,9 @@
 #include "net/rpl/rpl-private.h"
 #include "net/ip/uip-udp-packet.h"
 #include "net/ip/uip-debug.h"
+#if MOBIRPL_TSCH
+#include "net/mac/tsch/tsch.h"
+#endif
 #include "lib/random.h"
 #include <stdio.h>
 
@@ -62,6 +65,9 @@ struct app_data {
   uint8_t hop;
   uint8_t ping;
   uint16_t dummy_for_padding;
+#if APP_PAYLOAD_PADDING
+  uint8_t padding[APP_PAYLOAD_PADDING];
+#endif
 };
 
 static struct ctimer down_send_timer;
@@ -108,8 +114,10 @@ simple_energest_step(int verbose)
   last_time = curr_time;
 
   if(verbose) {
-    uint32_t fraction = (1000ul * (delta_tx + delta_rx)) / delta_time;
-    uint32_t all_fraction = (1000ul * (curr_tx + curr_rx)) / curr_time;
+    uint32_t fraction = delta_time == 0 ? 0 :
+      (1000ul * (delta_tx + delta_rx)) / delta_time;
+    uint32_t all_fraction = curr_time == 0 ? 0 :
+      (1000ul * (curr_tx + curr_rx)) / curr_time;
     printf("dc:[%u %u]|%8lu|+|%8lu|/|%8lu|(%lu|permil)|%lu\n",
         node_id,
         energest_cnt++,
@@ -117,6 +125,19 @@ simple_energest_step(int verbose)
         fraction,
         all_fraction
         );
+#if ENERGEST_WITH_CAUSES
+    /* cumulative tx+rx radio time per cause, in the order of
+       enum energest_cause: data|dio|dio resp|reactive dis|proactive dis|probing dis|dao */
+    {
+      int i;
+      printf("dc:c|%u|%u", node_id, energest_cnt - 1);
+      for(i = 0; i < ENERGEST_CAUSE_MAX; i++) {
+        printf("|%lu", energest_cause_time(i, ENERGEST_TYPE_TRANSMIT) +
+                       energest_cause_time(i, ENERGEST_TYPE_LISTEN));
+      }
+      printf("\n");
+    }
+#endif
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -183,6 +204,9 @@ app_send(void *ptr)
   data.src = UIP_HTONS(node_id);
   data.dest = UIP_HTONS(receiver_id);
   data.hop = 0;
+#if APP_PAYLOAD_PADDING
+  memset(data.padding, 0, sizeof(data.padding));
+#endif
 
   rpl_dag_t *dag = rpl_get_any_dag();
 
@@ -190,7 +214,8 @@ app_send(void *ptr)
 
   printf("a:txd|%u|t|%u|s|%lx|h|%u\n", ++app_tx_num[index], receiver_id, 
     (unsigned long)UIP_HTONL(data.seqno),
-    DAG_RANK(dag->preferred_parent->rank, dag->instance));
+    dag != NULL && dag->preferred_parent != NULL ?
+    DAG_RANK(dag->preferred_parent->rank, dag->instance) : 0);
 
   uip_udp_packet_sendto(server_conn, &data, sizeof(data),
           &client_ipaddr, UIP_HTONS(UDP_CLIENT_PORT));
@@ -265,7 +290,12 @@ PROCESS_THREAD(udp_sink_process, ev, data)
 
   print_local_addresses();
 
+#if MOBIRPL_TSCH
+  /* The root starts the TSCH network */
+  tsch_set_coordinator(1);
+#endif
   NETSTACK_RDC.off(1);
+  rpl_set_always_on(1);
 
 #if MOBIRPL_RH_OF
   printf("a:rhof|%d\n", RSSI_LOW_THRESHOLD);
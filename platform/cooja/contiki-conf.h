@@ -38,7 +38,10 @@
 #endif /* INCLUDE_SUBPLATFORM_CONF */
 
 #define PROFILE_CONF_ON 0
+#ifndef ENERGEST_CONF_ON
 #define ENERGEST_CONF_ON 0
+#endif /* ENERGEST_CONF_ON */
+#define ENERGEST_CONF_CURRENT_TIME rtimer_arch_sim_time
 #define LOG_CONF_ENABLED 1
 #define RIMESTATS_CONF_ON 1
 #define RIMESTATS_CONF_ENABLED 1
@@ -186,10 +186,15 @@ set_rime_addr(void)
 
   memset(&addr, 0, sizeof(linkaddr_t));
 #if NETSTACK_CONF_WITH_IPV6
+#if COOJA_CONF_NODE_ID_MAC_ADDRESS
+  /* hckim mobirpl: 00:00:00:00:00:00:00:<node id>, as on the Sky motes */
+  addr.u8[sizeof(uip_lladdr.addr) - 1] = node_id & 0xff;
+#else /* COOJA_CONF_NODE_ID_MAC_ADDRESS */
   for(i = 0; i < sizeof(uip_lladdr.addr); i += 2) {
     addr.u8[i + 1] = node_id & 0xff;
     addr.u8[i + 0] = node_id >> 8;
   }
+#endif /* COOJA_CONF_NODE_ID_MAC_ADDRESS */
 #else /* NETSTACK_CONF_WITH_IPV6 */
   addr.u8[0] = node_id & 0xff;
   addr.u8[1] = node_id >> 8;
@@ -207,6 +212,9 @@ contiki_init()
 {
   /* Initialize random generator (moved to moteid.c) */
 
+  energest_init();
+  ENERGEST_ON(ENERGEST_TYPE_CPU);
+
   /* Start process handler */
   process_init();
 
@@ -449,6 +457,10 @@ Java_org_contikios_cooja_corecomm_CLASSNAME_tick(JNIEnv *env, jobject obj)
 
   simProcessRunValue = 0;
 
+  /* The mote sleeps between ticks */
+  ENERGEST_OFF(ENERGEST_TYPE_LPM);
+  ENERGEST_ON(ENERGEST_TYPE_CPU);
+
   /* Let all simulation interfaces act first */
   doActionsBeforeTick();
 
@@ -470,6 +482,9 @@ Java_org_contikios_cooja_corecomm_CLASSNAME_tick(JNIEnv *env, jobject obj)
   /* Let all simulation interfaces act before returning to java */
   doActionsAfterTick();
 
+  ENERGEST_OFF(ENERGEST_TYPE_CPU);
+  ENERGEST_ON(ENERGEST_TYPE_LPM);
+
   /* Do we have any pending timers */
   simEtimerPending = etimer_pending() || rtimer_arch_pending();
   if(!simEtimerPending) {
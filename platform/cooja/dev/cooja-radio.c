@@ -49,6 +49,16 @@
 #define WITH_TURNAROUND 1
 #define WITH_SEND_CCA 1
 
+/* Frames of up to 3 bytes are taken for ACKs and get the shorter
+   turnaround. With COOJA_RADIO_CONF_ACK_BY_FRAME_TYPE, e.g. for the
+   anycast ACKs of ContikiMAC, which carry the address of the node that
+   took the frame, any frame of the 802.15.4 ACK frame type does. */
+#ifdef COOJA_RADIO_CONF_ACK_BY_FRAME_TYPE
+#define ACK_BY_FRAME_TYPE COOJA_RADIO_CONF_ACK_BY_FRAME_TYPE
+#else
+#define ACK_BY_FRAME_TYPE 0
+#endif
+
 const struct simInterface radio_interface;
 
 /* COOJA */
@@ -64,6 +74,10 @@ char simPower = 100;
 int simRadioChannel = 26;
 int simLQI = 105;
 
+/* hckim mobirpl: contikimac and nullrdc read the RSSI of received ACKs
+   from the CC2420 driver */
+signed char cc2420_last_rssi;
+
 static const void *pending_data;
 
 PROCESS(cooja_radio_process, "cooja radio process");
@@ -103,6 +117,9 @@ radio_LQI(void)
 static int
 radio_on(void)
 {
+  if(!simRadioHWOn) {
+    ENERGEST_ON(ENERGEST_TYPE_LISTEN);
+  }
   simRadioHWOn = 1;
   return 1;
 }
@@ -110,6 +127,7 @@ radio_on(void)
 static int
 radio_off(void)
 {
+  ENERGEST_OFF(ENERGEST_TYPE_LISTEN);
   simRadioHWOn = 0;
   return 1;
 }
@@ -152,8 +170,11 @@ radio_read(void *buf, unsigned short bufsize)
 
   memcpy(buf, simInDataBuffer, simInSize);
   simInSize = 0;
-  packetbuf_set_attr(PACKETBUF_ATTR_RSSI, simSignalStrength);
+  /* The signal strength during the reception, as the radio may have
+     been retuned since */
+  packetbuf_set_attr(PACKETBUF_ATTR_RSSI, simLastSignalStrength);
   packetbuf_set_attr(PACKETBUF_ATTR_LINK_QUALITY, simLQI);
+  cc2420_last_rssi = simLastSignalStrength;
 
   return tmp;
 }
@@ -176,7 +197,11 @@ radio_send(const void *payload, unsigned short payload_len)
 #if WITH_TURNAROUND
   simProcessRunValue = 1;
   cooja_mt_yield();
+#if ACK_BY_FRAME_TYPE
+  if(payload_len == 0 || (((const uint8_t *)payload)[0] & 7) != 2) {
+#else /* ACK_BY_FRAME_TYPE */
   if(payload_len > 3) {
+#endif /* ACK_BY_FRAME_TYPE */
     simProcessRunValue = 1;
     cooja_mt_yield();
   }
@@ -208,9 +233,15 @@ radio_send(const void *payload, unsigned short payload_len)
   simOutSize = payload_len;
 
   /* Transmit */
+  ENERGEST_OFF(ENERGEST_TYPE_LISTEN);
+  ENERGEST_ON(ENERGEST_TYPE_TRANSMIT);
   while(simOutSize > 0) {
     cooja_mt_yield();
   }
+  ENERGEST_OFF(ENERGEST_TYPE_TRANSMIT);
+  if(radiostate) {
+    ENERGEST_ON(ENERGEST_TYPE_LISTEN);
+  }
 
   simRadioHWOn = radiostate;
   return RADIO_TX_OK;
@@ -268,6 +299,9 @@ PROCESS_THREAD(cooja_radio_process, ev, data)
 static int
 init(void)
 {
+  if(simRadioHWOn) {
+    ENERGEST_ON(ENERGEST_TYPE_LISTEN);
+  }
   process_start(&cooja_radio_process, NULL);
   return 1;
 }
@@ -275,13 +309,37 @@ init(void)
 static radio_result_t
 get_value(radio_param_t param, radio_value_t *value)
 {
-  return RADIO_RESULT_NOT_SUPPORTED;
+  if(value == NULL) {
+    return RADIO_RESULT_INVALID_VALUE;
+  }
+  switch(param) {
+  case RADIO_PARAM_CHANNEL:
+    *value = simRadioChannel;
+    return RADIO_RESULT_OK;
+  case RADIO_CONST_CHANNEL_MIN:
+    *value = 11;
+    return RADIO_RESULT_OK;
+  case RADIO_CONST_CHANNEL_MAX:
+    *value = 26;
+    return RADIO_RESULT_OK;
+  default:
+    return RADIO_RESULT_NOT_SUPPORTED;
+  }
 }
 /*---------------------------------------------------------------------------*/
 static radio_result_t
 set_value(radio_param_t param, radio_value_t value)
 {
-  return RADIO_RESULT_NOT_SUPPORTED;
+  switch(param) {
+  case RADIO_PARAM_CHANNEL:
+    if(value < 11 || value > 26) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    radio_set_channel(value);
+    return RADIO_RESULT_OK;
+  default:
+    return RADIO_RESULT_NOT_SUPPORTED;
+  }
 }
 /*---------------------------------------------------------------------------*/
 static radio_result_t
@@ -107,4 +107,12 @@ rtimer_arch_now(void)
   return simCurrentTime;
 }
 /*---------------------------------------------------------------------------*/
+/* The simulation time, without yielding to COOJA as rtimer_arch_now()
+   does. For energest, which must not change the timing of the node. */
+rtimer_clock_t
+rtimer_arch_sim_time(void)
+{
+  return simCurrentTime;
+}
+/*---------------------------------------------------------------------------*/
 
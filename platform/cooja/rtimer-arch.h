@@ -42,5 +42,6 @@ rtimer_clock_t rtimer_arch_now(void);
 int rtimer_arch_check(void);
 int rtimer_arch_pending(void);
 rtimer_clock_t rtimer_arch_next(void);
+rtimer_clock_t rtimer_arch_sim_time(void);
 
 #endif /* RTIMER_ARCH_H_ */
@@ -30,6 +30,7 @@
 
 #include "contiki-conf.h"
 #include "sys/clock.h"
+#include "sys/cooja_mt.h"
 #include "lib/simEnvChange.h"
 
 const struct simInterface clock_interface;
@@ -60,6 +61,19 @@ clock_delay(unsigned int delay_time)
 {
 }
 /*-----------------------------------------------------------------------------------*/
+void
+clock_wait(clock_time_t t)
+{
+  clock_time_t start = simCurrentTime;
+
+  while(simCurrentTime - start < t) {
+    /* Yield to COOJA, to allow time to change */
+    simProcessRunValue = 1;
+    simNextExpirationTime = simCurrentTime + 1;
+    cooja_mt_yield();
+  }
+}
+/*-----------------------------------------------------------------------------------*/
 static void
 doInterfaceActionsBeforeTick(void)
 {
@@ -30,8 +30,10 @@
  */
 
 import java.io.File;
+import java.io.IOException;
 import java.util.ArrayList;
 import java.util.Collection;
+import java.util.HashMap;
 
 import javax.swing.JFileChooser;
 import javax.swing.JScrollPane;
@@ -48,7 +50,6 @@ import org.contikios.cooja.TimeEvent;
 import org.contikios.cooja.VisPlugin;
 import org.contikios.cooja.dialogs.MessageList;
 import org.contikios.cooja.interfaces.Position;
-import org.contikios.cooja.util.StringUtils;
 
 @ClassDescription("Mobility")
 @PluginType(PluginType.SIM_PLUGIN)
@@ -59,11 +60,18 @@ public class Mobility extends VisPlugin {
   private static final boolean QUIET = false;
 
   private final boolean WRAP_MOVES = true; /* Wrap around loaded moves forever */
-  
-  private Move[] entries; /* All mote moves */
+
+  /* Position update interval for motes moving between waypoints */
+  private static final long DEFAULT_INTERPOLATION_INTERVAL = 200; /* ms */
+
+  private MobilityTrace.Reader trace; /* Streamed mote moves */
+  private MobilityTrace.Waypoint nextMove;
   private Simulation simulation;
   private long periodStart; /* us */
-  private int currentMove;
+  private long interpolationInterval = DEFAULT_INTERPOLATION_INTERVAL*Simulation.MILLISECOND;
+
+  /* Motes moving between waypoints, by mote index */
+  private HashMap<Integer, Move> moving = new HashMap<Integer, Move>();
 
   private File filePositions = null;
 
@@ -109,105 +117,162 @@ public class Mobility extends VisPlugin {
   private void loadPositions() {
     try {
       if (!QUIET) {
-        log.addMessage("Parsing position file: " + filePositions);
-        logger.info("Parsing position file: " + filePositions);
+        log.addMessage("Streaming position file: " + filePositions);
+        logger.info("Streaming position file: " + filePositions);
       }
-  
-      String data = StringUtils.loadFromFile(filePositions);
-      
-      /* Load move by move */
-      ArrayList<Move> entriesList = new ArrayList<Move>();
-      for (String line: data.split("\n")) {
-        if (line.trim().isEmpty() || line.startsWith("#")) {
-          /* Skip header/metadata */
-          continue;
-        }
-
-        String[] args = line.split(" ");
-        Move e = new Move();
-        e.moteIndex = Integer.parseInt(args[0]); /* XXX Mote index. Not ID */
-        e.time = (long) (Double.parseDouble(args[1])*1000.0*Simulation.MILLISECOND); /* s -> us */
-        e.posX = Double.parseDouble(args[2]);
-        e.posY = Double.parseDouble(args[3]);
 
-        entriesList.add(e);
+      /* Moves are read lazily, one ahead of the simulation */
+      trace = MobilityTrace.open(filePositions);
+      if (!QUIET && trace instanceof MobilityTrace.BinaryReader) {
+        MobilityTrace.BinaryReader binary = (MobilityTrace.BinaryReader) trace;
+        log.addMessage("Binary trace: " + binary.getWaypointsCount() + " waypoints, "
+            + binary.getMotesCount() + " motes, " + binary.getDuration()/Simulation.MILLISECOND + " ms");
+        logger.info("Binary trace: " + binary.getWaypointsCount() + " waypoints, "
+            + binary.getMotesCount() + " motes, " + binary.getDuration()/Simulation.MILLISECOND + " ms");
       }
-      entries = entriesList.toArray(new Move[0]);
-      if (!QUIET) {
-        log.addMessage("Loaded " + entries.length + " positions");
-        logger.info("Loaded " + entries.length + " positions");
+      nextMove = trace.next();
+      if (nextMove == null) {
+        log.addMessage("No positions in " + filePositions);
+        return;
       }
 
       setTitle("Mobility: " + filePositions.getName());
-      
+
       /* Execute first event - it will reschedule itself */
       simulation.invokeSimulationThread(new Runnable() {
         public void run() {
-          currentMove = 0;
           periodStart = simulation.getSimulationTime();
           /*logger.debug("periodStart: " + periodStart);*/
           moveNextMoteEvent.execute(Mobility.this.simulation.getSimulationTime());
         }
       });
 
-    } catch (Exception e) {
+    } catch (IOException e) {
       log.addMessage("Error when loading positions: " + e.getMessage());
       logger.info("Error when loading positions:", e);
-      entries = new Move[0];
+      closeTrace();
     }
   }
 
+  private void closeTrace() {
+    if (trace != null) {
+      trace.close();
+      trace = null;
+    }
+    nextMove = null;
+  }
+
   private TimeEvent moveNextMoteEvent = new TimeEvent(0) {
     public void execute(long t) {
+      if (nextMove == null) {
+        return;
+      }
 
       /* Detect early events: reschedule for later */
-      if (simulation.getSimulationTime() < entries[currentMove].time + periodStart) {
-        simulation.scheduleEvent(this, entries[currentMove].time + periodStart);
+      if (simulation.getSimulationTime() < nextMove.time + periodStart) {
+        simulation.scheduleEvent(this, nextMove.time + periodStart);
         return;
       }
 
       /* Perform a single move */
-      Move move = entries[currentMove];
+      MobilityTrace.Waypoint move = nextMove;
       if (move.moteIndex < simulation.getMotesCount()) {
         Mote mote = simulation.getMote(move.moteIndex);
         Position pos = mote.getInterfaces().getPosition();
         pos.setCoordinates(move.posX, move.posY, pos.getZCoordinate());
         /*logger.info(simulation.getSimulationTimeMillis() + ": Executing " + move);*/
+
+        /* Binary traces: move linearly towards the next waypoint */
+        if (move.speedX != 0 || move.speedY != 0) {
+          moving.put(move.moteIndex, new Move(move, simulation.getSimulationTime()));
+          if (!interpolateEvent.isScheduled()) {
+            simulation.scheduleEvent(interpolateEvent,
+                simulation.getSimulationTime() + interpolationInterval);
+          }
+        } else {
+          moving.remove(move.moteIndex);
+        }
       } else {
         /*log.addMessage(simulation.getSimulationTimeMillis() + ": Bad move, no mote " + move.moteIndex);
         logger.warn(simulation.getSimulationTimeMillis() + ": No such mote, skipping move " + move);*/
       }
 
-      currentMove++;
-      if (currentMove >= entries.length) {
-        if (!WRAP_MOVES) {
-          return;
+      try {
+        nextMove = trace.next();
+        if (nextMove == null) {
+          if (!WRAP_MOVES) {
+            closeTrace();
+            return;
+          }
+          /*log.addMessage("New mobility period at " + simulation.getSimulationTime());*/
+          /*logger.info("New mobility period at " + simulation.getSimulationTime());*/
+          trace.close();
+          trace = MobilityTrace.open(filePositions);
+          periodStart = simulation.getSimulationTime();
+          moving.clear();
+          nextMove = trace.next();
+          if (nextMove == null) {
+            closeTrace();
+            return;
+          }
         }
-        /*log.addMessage("New mobility period at " + simulation.getSimulationTime());*/
-        /*logger.info("New mobility period at " + simulation.getSimulationTime());*/
-        periodStart = simulation.getSimulationTime();
-        currentMove = 0;
+      } catch (IOException e) {
+        log.addMessage("Error when reading positions: " + e.getMessage());
+        logger.warn("Error when reading positions:", e);
+        closeTrace();
+        return;
       }
 
       /* Reschedule future events */
-      simulation.scheduleEvent(this, entries[currentMove].time + periodStart);
+      simulation.scheduleEvent(this, nextMove.time + periodStart);
+    }
+  };
+
+  private TimeEvent interpolateEvent = new TimeEvent(0) {
+    public void execute(long t) {
+      if (moving.isEmpty()) {
+        return;
+      }
+      for (Move move: moving.values()) {
+        if (move.moteIndex >= simulation.getMotesCount()) {
+          continue;
+        }
+        double dt = (t - move.startTime) / (1000.0*Simulation.MILLISECOND);
+        Position pos = simulation.getMote(move.moteIndex).getInterfaces().getPosition();
+        pos.setCoordinates(move.posX + dt*move.speedX, move.posY + dt*move.speedY,
+            pos.getZCoordinate());
+      }
+      simulation.scheduleEvent(this, t + interpolationInterval);
     }
   };
 
   public void closePlugin() {
     moveNextMoteEvent.remove();
+    interpolateEvent.remove();
+    closeTrace();
   }
 
+  /* A mote moving from a waypoint, started at startTime (us) */
   class Move {
-    long time;
+    long startTime;
     int moteIndex;
     double posX, posY;
+    double speedX, speedY; /* m/s */
+
+    Move(MobilityTrace.Waypoint waypoint, long startTime) {
+      this.startTime = startTime;
+      this.moteIndex = waypoint.moteIndex;
+      this.posX = waypoint.posX;
+      this.posY = waypoint.posY;
+      this.speedX = waypoint.speedX;
+      this.speedY = waypoint.speedY;
+    }
 
     public String toString() {
-      return "MOVE: mote " + moteIndex + " -> [" + posX + "," + posY + "] @ " + time/Simulation.MILLISECOND;
+      return "MOVE: mote " + moteIndex + " from [" + posX + "," + posY + "] @ " + startTime/Simulation.MILLISECOND;
     }
   }
-  
+
   public Collection<Element> getConfigXML() {
     ArrayList<Element> config = new ArrayList<Element>();
     Element element;
@@ -220,10 +285,23 @@ public class Mobility extends VisPlugin {
       config.add(element);
     }
 
+    if (interpolationInterval != DEFAULT_INTERPOLATION_INTERVAL*Simulation.MILLISECOND) {
+      element = new Element("interpolation_interval");
+      element.setText("" + interpolationInterval/Simulation.MILLISECOND);
+      config.add(element);
+    }
+
     return config;
   }
   
   public boolean setConfigXML(Collection<Element> configXML, boolean visAvailable) {
+    for (Element element : configXML) {
+      String name = element.getName();
+
+      if (name.equals("interpolation_interval")) {
+        interpolationInterval = Math.max(1, Long.parseLong(element.getText().trim()))*Simulation.MILLISECOND;
+      }
+    }
     for (Element element : configXML) {
       String name = element.getName();
 
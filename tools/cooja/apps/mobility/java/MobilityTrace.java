@@ -0,0 +1,477 @@
+/*
+ * Copyright (c) 2026, the MobiRPL contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.BufferedReader;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.EOFException;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.FileOutputStream;
+import java.io.FileReader;
+import java.io.IOException;
+import java.io.RandomAccessFile;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.PriorityQueue;
+
+/**
+ * Mobility traces: streaming readers for the text format
+ * ("moteIndex time x y", one waypoint per line, in time order) and for a
+ * compact binary format, plus a converter from text to binary.
+ *
+ * Binary format (big-endian, as written by DataOutputStream):
+ * <pre>
+ * header:  int    magic "MOBT"
+ *          short  version
+ *          short  flags (unused, 0)
+ *          int    number of motes (highest mote index + 1)
+ *          long   number of waypoints
+ *          long   time of the last waypoint (us)
+ * waypoint, in time order:
+ *          int    time since the previous waypoint (us)
+ *          short  mote index
+ *          float  x, y (m)
+ *          float  speed x, speed y (m/s) towards the mote's next waypoint
+ * </pre>
+ *
+ * The speeds let the plugin interpolate linearly between waypoints, so a
+ * mote moving at constant speed needs only one waypoint per leg. The
+ * converter drops waypoints that interpolation reproduces within a given
+ * tolerance (default 0.01 m).
+ *
+ * Usage: java -cp mobility.jar MobilityTrace [-tolerance m] [-horizon s] in.txt out.mob
+ */
+public class MobilityTrace {
+  public static final int MAGIC = 0x4d4f4254; /* "MOBT" */
+  public static final short VERSION = 1;
+  public static final int HEADER_SIZE = 28;
+  public static final int WAYPOINT_SIZE = 22;
+
+  private static final long US_PER_SECOND = 1000000;
+
+  /**
+   * A single waypoint.
+   */
+  public static class Waypoint {
+    public long time; /* us */
+    public int moteIndex;
+    public double posX, posY;
+    public double speedX, speedY; /* m/s */
+
+    public String toString() {
+      return "MOVE: mote " + moteIndex + " -> [" + posX + "," + posY + "] @ " + time/1000;
+    }
+  }
+
+  /**
+   * Waypoint source, read lazily in time order.
+   */
+  public interface Reader {
+    /**
+     * @return Next waypoint, or null at end of trace
+     */
+    public Waypoint next() throws IOException;
+    public void close();
+  }
+
+  /**
+   * @param file Trace file
+   * @return True if file is a binary trace
+   */
+  public static boolean isBinary(File file) throws IOException {
+    DataInputStream in = new DataInputStream(new FileInputStream(file));
+    try {
+      return in.readInt() == MAGIC;
+    } catch (EOFException e) {
+      return false;
+    } finally {
+      in.close();
+    }
+  }
+
+  /**
+   * Opens a trace in either format.
+   *
+   * @param file Trace file
+   * @return Reader positioned at the first waypoint
+   */
+  public static Reader open(File file) throws IOException {
+    if (isBinary(file)) {
+      return new BinaryReader(file);
+    }
+    return new TextReader(file);
+  }
+
+  private static Waypoint parseLine(String line, int lineNr) throws IOException {
+    String[] args = line.trim().split("\\s+");
+    if (args.length < 4) {
+      throw new IOException("Line " + lineNr + ": expected 'moteIndex time x y'");
+    }
+    try {
+      Waypoint w = new Waypoint();
+      w.moteIndex = Integer.parseInt(args[0]); /* XXX Mote index. Not ID */
+      w.time = (long) (Double.parseDouble(args[1])*US_PER_SECOND); /* s -> us */
+      w.posX = Double.parseDouble(args[2]);
+      w.posY = Double.parseDouble(args[3]);
+      return w;
+    } catch (NumberFormatException e) {
+      throw new IOException("Line " + lineNr + ": " + e.getMessage());
+    }
+  }
+
+  /**
+   * Text trace reader. Waypoints have no speed.
+   */
+  public static class TextReader implements Reader {
+    private BufferedReader in;
+    private int lineNr = 0;
+
+    public TextReader(File file) throws IOException {
+      in = new BufferedReader(new FileReader(file));
+    }
+
+    public Waypoint next() throws IOException {
+      String line;
+      while ((line = in.readLine()) != null) {
+        lineNr++;
+        if (line.trim().isEmpty() || line.startsWith("#")) {
+          /* Skip header/metadata */
+          continue;
+        }
+        return parseLine(line, lineNr);
+      }
+      return null;
+    }
+
+    public void close() {
+      try {
+        in.close();
+      } catch (IOException e) {
+      }
+    }
+  }
+
+  /**
+   * Binary trace reader.
+   */
+  public static class BinaryReader implements Reader {
+    private DataInputStream in;
+    private int motes;
+    private long waypoints;
+    private long duration;
+    private long read = 0;
+    private long time = 0;
+
+    public BinaryReader(File file) throws IOException {
+      in = new DataInputStream(new BufferedInputStream(new FileInputStream(file)));
+      try {
+        if (in.readInt() != MAGIC) {
+          throw new IOException("Not a binary mobility trace: " + file);
+        }
+        short version = in.readShort();
+        if (version != VERSION) {
+          throw new IOException("Unsupported mobility trace version: " + version);
+        }
+        in.readShort(); /* flags */
+        motes = in.readInt();
+        waypoints = in.readLong();
+        duration = in.readLong();
+      } catch (IOException e) {
+        close();
+        throw e;
+      }
+    }
+
+    public int getMotesCount() {
+      return motes;
+    }
+    public long getWaypointsCount() {
+      return waypoints;
+    }
+    public long getDuration() {
+      return duration;
+    }
+
+    public Waypoint next() throws IOException {
+      if (read >= waypoints) {
+        return null;
+      }
+      Waypoint w = new Waypoint();
+      time += in.readInt() & 0xffffffffL;
+      w.time = time;
+      w.moteIndex = in.readShort() & 0xffff;
+      w.posX = in.readFloat();
+      w.posY = in.readFloat();
+      w.speedX = in.readFloat();
+      w.speedY = in.readFloat();
+      read++;
+      return w;
+    }
+
+    public void close() {
+      try {
+        in.close();
+      } catch (IOException e) {
+      }
+    }
+  }
+
+  /**
+   * Text to binary converter. Streams the input: as long as the input is
+   * in time order, memory use grows with the number of motes and the
+   * horizon, not with the length of the trace.
+   *
+   * Consecutive waypoints of a mote are joined by linear legs. Waypoints
+   * that a leg reproduces within the tolerance are dropped. Legs longer
+   * than the horizon are not interpolated: the mote stays put and jumps
+   * to the next waypoint, as with text traces.
+   */
+  public static class Converter {
+    private final double tolerance; /* m */
+    private final long horizon; /* us */
+    private DataOutputStream out;
+
+    private class Track {
+      Waypoint anchor; /* Last kept waypoint, not yet written */
+      Waypoint candidate; /* Possible end of the anchor's leg */
+      ArrayList<Waypoint> skipped = new ArrayList<Waypoint>();
+    }
+    private HashMap<Integer, Track> tracks = new HashMap<Integer, Track>();
+
+    /* Completed waypoints, written once no earlier waypoint can follow */
+    private PriorityQueue<Waypoint> done = new PriorityQueue<Waypoint>(64,
+        new java.util.Comparator<Waypoint>() {
+          public int compare(Waypoint a, Waypoint b) {
+            if (a.time != b.time) {
+              return a.time < b.time ? -1 : 1;
+            }
+            return a.moteIndex - b.moteIndex;
+          }
+        });
+
+    private long written = 0;
+    private long lastTime = 0;
+    private long lastSweep = 0;
+    private int maxIndex = -1;
+    private long inputCount = 0;
+
+    public Converter(double tolerance, double horizon) {
+      this.tolerance = tolerance;
+      this.horizon = (long) (horizon*US_PER_SECOND);
+    }
+
+    public void convert(File input, File output) throws IOException {
+      TextReader in = new TextReader(input);
+      out = new DataOutputStream(new BufferedOutputStream(new FileOutputStream(output)));
+      try {
+        /* Header, counts are filled in afterwards */
+        out.writeInt(MAGIC);
+        out.writeShort(VERSION);
+        out.writeShort(0);
+        out.writeInt(0);
+        out.writeLong(0);
+        out.writeLong(0);
+
+        Waypoint w;
+        while ((w = in.next()) != null) {
+          add(w);
+        }
+        sweep(Long.MAX_VALUE);
+        flush(Long.MAX_VALUE);
+      } finally {
+        in.close();
+        out.close();
+      }
+
+      RandomAccessFile raf = new RandomAccessFile(output, "rw");
+      try {
+        raf.seek(8);
+        raf.writeInt(maxIndex + 1);
+        raf.writeLong(written);
+        raf.writeLong(lastTime);
+      } finally {
+        raf.close();
+      }
+    }
+
+    public long getInputCount() {
+      return inputCount;
+    }
+    public long getOutputCount() {
+      return written;
+    }
+
+    private void add(Waypoint w) throws IOException {
+      inputCount++;
+      if (w.moteIndex < 0 || w.moteIndex > 0xffff) {
+        throw new IOException("Mote index out of range: " + w);
+      }
+      maxIndex = Math.max(maxIndex, w.moteIndex);
+
+      Track track = tracks.get(w.moteIndex);
+      if (track == null) {
+        track = new Track();
+        tracks.put(w.moteIndex, track);
+      }
+      if (track.anchor == null) {
+        track.anchor = w;
+      } else {
+        Waypoint last = track.candidate != null ? track.candidate : track.anchor;
+        if (w.time < last.time) {
+          throw new IOException("Waypoints of mote " + w.moteIndex + " not in time order: " + w);
+        }
+        if (track.candidate != null) {
+          track.skipped.add(track.candidate);
+          if (!reproduces(track.anchor, w, track.skipped)) {
+            /* Candidate is needed: the anchor's leg ends there */
+            track.skipped.remove(track.skipped.size() - 1);
+            close(track);
+          }
+        }
+        track.candidate = w;
+      }
+
+      /* Finish stale legs and write what is complete, once per second */
+      if (w.time >= lastSweep + US_PER_SECOND) {
+        lastSweep = w.time;
+        sweep(w.time);
+        long pending = Long.MAX_VALUE;
+        for (Track t: tracks.values()) {
+          if (t.anchor != null) {
+            pending = Math.min(pending, t.anchor.time);
+          }
+        }
+        flush(pending);
+      }
+    }
+
+    /* Ends the anchor's leg at the candidate, which becomes the anchor */
+    private void close(Track track) {
+      Waypoint from = track.anchor;
+      Waypoint to = track.candidate;
+      double dt = (to.time - from.time) / (double) US_PER_SECOND;
+      if (dt > 0 && to.time - from.time <= horizon) {
+        from.speedX = (to.posX - from.posX) / dt;
+        from.speedY = (to.posY - from.posY) / dt;
+      }
+      done.add(from);
+      track.anchor = to;
+      track.candidate = null;
+      track.skipped.clear();
+    }
+
+    /* Completes legs that can no longer be extended before time now */
+    private void sweep(long now) {
+      for (Track t: tracks.values()) {
+        if (t.candidate != null &&
+            (now == Long.MAX_VALUE || t.candidate.time + horizon < now)) {
+          close(t);
+        }
+        if (t.anchor != null && t.candidate == null &&
+            (now == Long.MAX_VALUE || t.anchor.time + horizon < now)) {
+          /* No waypoint within the horizon: stationary */
+          done.add(t.anchor);
+          t.anchor = null;
+        }
+      }
+    }
+
+    /* True if all skipped waypoints lie on the leg from -> to */
+    private boolean reproduces(Waypoint from, Waypoint to, ArrayList<Waypoint> skip) {
+      if (to.time - from.time > horizon) {
+        return false;
+      }
+      double dt = to.time - from.time;
+      for (Waypoint s: skip) {
+        double f = dt > 0 ? (s.time - from.time) / dt : 0;
+        double x = from.posX + f * (to.posX - from.posX);
+        double y = from.posY + f * (to.posY - from.posY);
+        if (Math.hypot(x - s.posX, y - s.posY) > tolerance) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    private void flush(long before) throws IOException {
+      while (!done.isEmpty() && done.peek().time <= before) {
+        Waypoint w = done.poll();
+        long delta = w.time - lastTime;
+        if (delta < 0) {
+          throw new IOException("Waypoints not in time order: " + w);
+        }
+        if (delta > 0xffffffffL) {
+          throw new IOException("Gap between waypoints too long: " + w);
+        }
+        out.writeInt((int) delta);
+        out.writeShort(w.moteIndex);
+        out.writeFloat((float) w.posX);
+        out.writeFloat((float) w.posY);
+        out.writeFloat((float) w.speedX);
+        out.writeFloat((float) w.speedY);
+        lastTime = w.time;
+        written++;
+      }
+    }
+  }
+
+  public static void main(String[] args) {
+    double tolerance = 0.01;
+    double horizon = 60;
+    int arg = 0;
+    while (arg + 1 < args.length && args[arg].startsWith("-")) {
+      if (args[arg].equals("-tolerance")) {
+        tolerance = Double.parseDouble(args[arg + 1]);
+      } else if (args[arg].equals("-horizon")) {
+        horizon = Double.parseDouble(args[arg + 1]);
+      } else {
+        break;
+      }
+      arg += 2;
+    }
+    if (args.length - arg != 2) {
+      System.err.println("Usage: java -cp mobility.jar MobilityTrace [-tolerance m] [-horizon s] in.txt out.mob");
+      System.exit(1);
+    }
+
+    Converter converter = new Converter(tolerance, horizon);
+    try {
+      converter.convert(new File(args[arg]), new File(args[arg + 1]));
+    } catch (IOException e) {
+      System.err.println("Conversion failed: " + e.getMessage());
+      System.exit(1);
+    }
+    System.out.println("Converted " + converter.getInputCount() + " positions into "
+        + converter.getOutputCount() + " waypoints");
+  }
+}
@@ -32,6 +32,7 @@ package org.contikios.cooja.radiomediums;
 
 import java.util.ArrayList;
 import java.util.Collection;
+import java.util.HashMap;
 import java.util.Observable;
 import java.util.Observer;
 import java.util.Random;
@@ -70,11 +71,15 @@ import org.contikios.cooja.plugins.skins.UDGMVisualizerSkin;
  * The received radio packet signal strength grows inversely with the distance to the
  * transmitter.
  *
+ * Potential destinations are looked up in a uniform grid with cells sized to the
+ * largest radio range, so a transmission only considers radios in the sender's
+ * cell and its eight neighbor cells. The grid is updated incrementally when motes
+ * move.
+ *
  * @see #SS_STRONG
  * @see #SS_WEAK
  * @see #SS_NOTHING
  *
- * @see DirectedGraphMedium
  * @see UDGMVisualizerSkin
  * @author Fredrik Osterlind
  */
@@ -87,61 +92,34 @@ public class UDGM extends AbstractRadioMedium {
   public double TRANSMITTING_RANGE = 50; /* Transmission range. */
   public double INTERFERENCE_RANGE = 100; /* Interference range. Ignored if below transmission range. */
 
-  private DirectedGraphMedium dgrm; /* Used only for efficient destination lookup */
+  private RadioGrid grid = new RadioGrid(); /* Used only for efficient destination lookup */
 
   private Random random = null;
 
   public UDGM(Simulation simulation) {
     super(simulation);
     random = simulation.getRandomGenerator();
-    dgrm = new DirectedGraphMedium() {
-      protected void analyzeEdges() {
-        /* Create edges according to distances.
-         * XXX May be slow for mobile networks */
-        clearEdges();
-        for (Radio source: UDGM.this.getRegisteredRadios()) {
-          Position sourcePos = source.getPosition();
-          for (Radio dest: UDGM.this.getRegisteredRadios()) {
-            Position destPos = dest.getPosition();
-            /* Ignore ourselves */
-            if (source == dest) {
-              continue;
-            }
-            double distance = sourcePos.getDistanceTo(destPos);
-            if (distance < Math.max(TRANSMITTING_RANGE, INTERFERENCE_RANGE)) {
-              /* Add potential destination */
-              addEdge(
-                  new DirectedGraphMedium.Edge(source, 
-                      new DGRMDestinationRadio(dest)));
-            }
-          }
-        }
-        super.analyzeEdges();
-      }
-    };
 
     /* Register as position observer.
-     * If any positions change, re-analyze potential receivers. */
+     * If any positions change, move radio to its new grid cell. */
     final Observer positionObserver = new Observer() {
       public void update(Observable o, Object arg) {
-        dgrm.requestEdgeAnalysis();
+        Mote mote = (Mote) arg;
+        grid.update(mote.getInterfaces().getRadio());
       }
     };
-    /* Re-analyze potential receivers if radios are added/removed. */
     simulation.getEventCentral().addMoteCountListener(new MoteCountListener() {
       public void moteWasAdded(Mote mote) {
         mote.getInterfaces().getPosition().addObserver(positionObserver);
-        dgrm.requestEdgeAnalysis();
       }
       public void moteWasRemoved(Mote mote) {
         mote.getInterfaces().getPosition().deleteObserver(positionObserver);
-        dgrm.requestEdgeAnalysis();
       }
     });
     for (Mote mote: simulation.getMotes()) {
       mote.getInterfaces().getPosition().addObserver(positionObserver);
     }
-    dgrm.requestEdgeAnalysis();
+    grid.requestRebuild();
 
     /* Register visualizer skin */
     Visualizer.registerVisualizerSkin(UDGMVisualizerSkin.class);
@@ -152,15 +130,153 @@ public class UDGM extends AbstractRadioMedium {
   	
 		Visualizer.unregisterVisualizerSkin(UDGMVisualizerSkin.class);
   }
+
+  public void registerRadioInterface(Radio radio, Simulation sim) {
+    super.registerRadioInterface(radio, sim);
+    grid.add(radio);
+  }
+
+  public void unregisterRadioInterface(Radio radio, Simulation sim) {
+    super.unregisterRadioInterface(radio, sim);
+    grid.remove(radio);
+  }
   
   public void setTxRange(double r) {
     TRANSMITTING_RANGE = r;
-    dgrm.requestEdgeAnalysis();
+    grid.requestRebuild();
   }
 
   public void setInterferenceRange(double r) {
     INTERFERENCE_RANGE = r;
-    dgrm.requestEdgeAnalysis();
+    grid.requestRebuild();
+  }
+
+  /**
+   * Uniform grid of registered radios, in the XY plane.
+   * Cells are squares with side max(TRANSMITTING_RANGE, INTERFERENCE_RANGE),
+   * so all radios within range of a sender are in the 3x3 cells around it.
+   * Output power only ever shrinks the ranges.
+   */
+  private class RadioGrid {
+    private double cellSize = 1.0;
+    private boolean dirty = true;
+    private HashMap<Long,ArrayList<Radio>> cells = new HashMap<Long,ArrayList<Radio>>();
+    private HashMap<Radio,Long> radioCells = new HashMap<Radio,Long>();
+
+    private double getMaxRange() {
+      double range = Math.max(TRANSMITTING_RANGE, INTERFERENCE_RANGE);
+      return range > 0 ? range : 1.0;
+    }
+    private long cellKey(int cx, int cy) {
+      return ((long) cx << 32) | (cy & 0xffffffffL);
+    }
+    private int cellIndex(double coordinate) {
+      return (int) Math.floor(coordinate / cellSize);
+    }
+    private long cellOf(Radio radio) {
+      Position pos = radio.getPosition();
+      return cellKey(cellIndex(pos.getXCoordinate()), cellIndex(pos.getYCoordinate()));
+    }
+
+    private void insert(Radio radio, long key) {
+      ArrayList<Radio> cell = cells.get(key);
+      if (cell == null) {
+        cell = new ArrayList<Radio>();
+        cells.put(key, cell);
+      }
+      cell.add(radio);
+      radioCells.put(radio, key);
+    }
+    private void erase(Radio radio, long key) {
+      ArrayList<Radio> cell = cells.get(key);
+      if (cell != null) {
+        cell.remove(radio);
+        if (cell.isEmpty()) {
+          cells.remove(key);
+        }
+      }
+      radioCells.remove(radio);
+    }
+
+    /**
+     * Signal that the ranges or radios changed, and that the grid must be
+     * rebuilt before used.
+     */
+    public void requestRebuild() {
+      dirty = true;
+    }
+
+    private void rebuild() {
+      cells.clear();
+      radioCells.clear();
+      cellSize = getMaxRange();
+      for (Radio radio: getRegisteredRadios()) {
+        insert(radio, cellOf(radio));
+      }
+      dirty = false;
+    }
+
+    public void add(Radio radio) {
+      if (radio == null || dirty || radioCells.containsKey(radio)) {
+        return;
+      }
+      insert(radio, cellOf(radio));
+    }
+
+    public void remove(Radio radio) {
+      if (radio == null || dirty) {
+        return;
+      }
+      Long key = radioCells.get(radio);
+      if (key != null) {
+        erase(radio, key);
+      }
+    }
+
+    public void update(Radio radio) {
+      if (radio == null || dirty) {
+        return;
+      }
+      Long oldKey = radioCells.get(radio);
+      if (oldKey == null) {
+        /* Not registered */
+        return;
+      }
+      long newKey = cellOf(radio);
+      if (newKey != oldKey) {
+        erase(radio, oldKey);
+        insert(radio, newKey);
+      }
+    }
+
+    /**
+     * @param source Source radio
+     * @return All other radios in the source radio's and neighboring cells
+     */
+    public ArrayList<Radio> getNearbyRadios(Radio source) {
+      /* Ranges are public fields: also catch direct changes */
+      if (dirty || cellSize != getMaxRange()) {
+        rebuild();
+      }
+      ArrayList<Radio> nearby = new ArrayList<Radio>();
+      Position pos = source.getPosition();
+      int cx = cellIndex(pos.getXCoordinate());
+      int cy = cellIndex(pos.getYCoordinate());
+      for (int x = cx - 1; x <= cx + 1; x++) {
+        for (int y = cy - 1; y <= cy + 1; y++) {
+          ArrayList<Radio> cell = cells.get(cellKey(x, y));
+          if (cell == null) {
+            continue;
+          }
+          for (Radio radio: cell) {
+            if (radio != source) {
+              nearby.add(radio);
+            }
+          }
+        }
+      }
+      return nearby;
+    }
   }
 
   public RadioConnection createConnections(Radio sender) {
@@ -178,15 +294,11 @@ public class UDGM extends AbstractRadioMedium {
     * ((double) sender.getCurrentOutputPowerIndicator() / (double) sender.getOutputPowerIndicatorMax());
 
     /* Get all potential destination radios */
-    DestinationRadio[] potentialDestinations = dgrm.getPotentialDestinations(sender);
-    if (potentialDestinations == null) {
-      return newConnection;
-    }
+    ArrayList<Radio> potentialDestinations = grid.getNearbyRadios(sender);
 
     /* Loop through all potential destinations */
     Position senderPos = sender.getPosition();
-    for (DestinationRadio dest: potentialDestinations) {
-      Radio recv = dest.radio;
+    for (Radio recv: potentialDestinations) {
 
       /* Fail if radios are on different (but configured) channels */ 
       if (sender.getChannel() >= 0 &&
@@ -399,6 +511,7 @@ public class UDGM extends AbstractRadioMedium {
         SUCCESS_RATIO_RX = Double.parseDouble(element.getText());
       }
     }
+    grid.requestRebuild();
     return true;
   }
 
@@ -0,0 +1,28 @@
+/*
+ * Minimal JNI declarations for building Cooja mote libraries without a
+ * JDK. Only what platform/cooja/contiki-cooja-main.c uses is declared;
+ * mobirpl-sim never calls the memory accessors, so the function table
+ * layout does not need to match a real JVM.
+ */
+
+#ifndef JNI_H_
+#define JNI_H_
+
+typedef int jint;
+typedef signed char jbyte;
+typedef void *jobject;
+typedef void *jbyteArray;
+
+struct JNINativeInterface_;
+typedef const struct JNINativeInterface_ *JNIEnv;
+
+struct JNINativeInterface_ {
+  void (*SetByteArrayRegion)(JNIEnv *, jbyteArray, jint, jint, const jbyte *);
+  jbyte *(*GetByteArrayElements)(JNIEnv *, jbyteArray, void *);
+  void (*ReleaseByteArrayElements)(JNIEnv *, jbyteArray, jbyte *, jint);
+};
+
+#define JNIEXPORT
+#define JNICALL
+
+#endif /* JNI_H_ */
@@ -0,0 +1,1009 @@
+/*
+ * Copyright (c) 2026, the MobiRPL contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holders nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ */
+
+/**
+ * \file
+ *         Headless multi-node simulator for MobiRPL evaluations.
+ *
+ *         Runs many Cooja mote libraries (platform/cooja) in a single
+ *         process without the Java simulator. Every node gets its own
+ *         private copy of the mote library, so all Contiki state is
+ *         per node and no memory needs to be swapped between ticks.
+ *         The harness reproduces the Cooja scheduler, the ContikiRadio
+ *         and ContikiClock interfaces and the UDGM radio medium, and
+ *         moves nodes according to a `moteIndex time x y` trace as
+ *         found in MobiRPL-traces/.
+ *
+ *         Runs are fully deterministic for a given seed.
+ */
+
+#include <dlfcn.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MILLISECOND             1000ULL
+#define SECOND                  (1000 * MILLISECOND)
+
+/* Must match COOJA_RADIO_BUFSIZE in platform/cooja/dev/cooja-radio.c */
+#define RADIO_BUFSIZE           128
+/* ContikiRadio default bitrate */
+#define RADIO_TRANSMISSION_RATE_KBPS 250
+/* Must match MAX_LOG_LENGTH in platform/cooja/sys/log.c */
+#define MAX_LOG_LENGTH          8192
+#define MAX_LINE_LENGTH         1024
+
+/* AbstractRadioMedium signal strengths */
+#define SS_NOTHING              -100
+#define SS_STRONG               -10
+#define SS_WEAK                 -95
+
+#define JNI_PREFIX              "Java_org_contikios_cooja_corecomm_"
+
+struct mote {
+  int index;
+  int id;
+  void *handle;
+  void (*tick)(void *env, void *obj);
+
+  /* Variables in the mote's private copy of the library */
+  unsigned long *sim_current_time;
+  int *sim_process_run_value;
+  int *sim_etimer_pending;
+  unsigned long *sim_next_expiration_time;
+  char *sim_receiving;
+  char *sim_in_data_buffer;
+  int *sim_in_size;
+  char *sim_out_data_buffer;
+  int *sim_out_size;
+  char *sim_radio_hw_on;
+  int *sim_signal_strength;
+  char *sim_power;
+  int *sim_radio_channel;
+  char *sim_logged_data;
+  int *sim_logged_length;
+  char *sim_logged_flag;
+
+  /* Clock */
+  int64_t drift;
+
+  /* Scheduler */
+  uint64_t wakeup_time;
+  uint64_t wakeup_seq;
+  int wakeup_scheduled;
+
+  /* Radio */
+  double x, y;
+  int radio_on;
+  int channel;
+  int transmitting;
+  int interfered;
+  uint64_t tx_end;
+  unsigned char rx_packet[RADIO_BUFSIZE];
+  int rx_len;
+  int has_rx_packet;
+
+  /* Log */
+  char line[MAX_LINE_LENGTH];
+  int line_len;
+
+  /* Statistics */
+  unsigned long ticks;
+  uint64_t radio_on_since;
+  uint64_t radio_on_time;
+};
+
+/* Per-mote membership flags of a radio connection */
+#define CONN_DESTINATION        0x01
+#define CONN_INTERFERED         0x02
+
+struct connection {
+  struct mote *source;
+  unsigned char *flags;
+};
+
+enum {
+  EVENT_WAKEUP,
+  EVENT_MOVE,
+};
+
+struct event {
+  uint64_t time;
+  uint64_t seq;
+  int type;
+  int index;
+  double x, y;
+};
+
+static struct mote *motes;
+static int nmotes;
+
+static struct connection *connections;
+static int nconnections;
+
+static struct event *events;
+static int nevents;
+static int events_size;
+static uint64_t event_seq;
+
+static uint64_t now;
+static uint64_t rng_state;
+static unsigned long random_seed;
+
+static double tx_range = 50;
+static double interference_range = 100;
+static double success_ratio_tx = 1.0;
+static double success_ratio_rx = 1.0;
+
+static FILE *trace;
+static long trace_line;
+
+static unsigned long stat_tx, stat_rx, stat_interfered;
+/*---------------------------------------------------------------------------*/
+static void
+usage(const char *prog)
+{
+  fprintf(stderr,
+          "usage: %s [options] -s sink.cooja -m mote.cooja -t trace\n"
+          "  -s lib    mote library for the sink\n"
+          "  -m lib    mote library for all other nodes\n"
+          "  -t file   mobility trace (moteIndex time x y)\n"
+          "  -n num    number of nodes (default: nodes in trace)\n"
+          "  -k id     node id of the sink (default: 1)\n"
+          "  -d sec    simulated time (default: end of trace)\n"
+          "  -r seed   random seed (default: 123456)\n"
+          "  -R m      UDGM transmission range (default: 50)\n"
+          "  -I m      UDGM interference range (default: 100)\n"
+          "  -T ratio  UDGM TX success ratio (default: 1.0)\n"
+          "  -X ratio  UDGM RX success ratio (default: 1.0)\n"
+          "  -D ms     maximum random node startup delay (default: 1000)\n"
+          "  -c name   CLASSNAME the libraries were built with (default: Lib1)\n"
+          "  -q        do not print node output\n",
+          prog);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+/* xorshift64*: small, fast and identical on every host */
+static uint64_t
+rng_next(void)
+{
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 2685821657736338717ULL;
+}
+/*---------------------------------------------------------------------------*/
+static double
+rng_double(void)
+{
+  return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+/*---------------------------------------------------------------------------*/
+static int
+event_before(const struct event *a, const struct event *b)
+{
+  if(a->time != b->time) {
+    return a->time < b->time;
+  }
+  return a->seq < b->seq;
+}
+/*---------------------------------------------------------------------------*/
+static void
+event_push(struct event *e)
+{
+  int i;
+
+  if(nevents == events_size) {
+    events_size = events_size == 0 ? 64 : events_size * 2;
+    events = realloc(events, events_size * sizeof(struct event));
+    if(events == NULL) {
+      perror("realloc");
+      exit(1);
+    }
+  }
+  e->seq = event_seq++;
+  i = nevents++;
+  while(i > 0 && event_before(e, &events[(i - 1) / 2])) {
+    events[i] = events[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  events[i] = *e;
+}
+/*---------------------------------------------------------------------------*/
+static int
+event_pop(struct event *e)
+{
+  struct event last;
+  int i, child;
+
+  if(nevents == 0) {
+    return 0;
+  }
+  *e = events[0];
+  last = events[--nevents];
+  i = 0;
+  while((child = 2 * i + 1) < nevents) {
+    if(child + 1 < nevents && event_before(&events[child + 1], &events[child])) {
+      child++;
+    }
+    if(!event_before(&events[child], &last)) {
+      break;
+    }
+    events[i] = events[child];
+    i = child;
+  }
+  events[i] = last;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* AbstractWakeupMote.scheduleNextWakeup(): keep the earliest wakeup only */
+static void
+schedule_wakeup(struct mote *m, uint64_t time)
+{
+  struct event e;
+
+  if(m->wakeup_scheduled && m->wakeup_time <= time) {
+    return;
+  }
+  memset(&e, 0, sizeof(e));
+  e.time = time;
+  e.type = EVENT_WAKEUP;
+  e.index = m->index;
+  event_push(&e);
+  m->wakeup_time = time;
+  m->wakeup_seq = e.seq;
+  m->wakeup_scheduled = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+lookup(struct mote *m, const char *name)
+{
+  void *p;
+
+  p = dlsym(m->handle, name);
+  if(p == NULL) {
+    fprintf(stderr, "node %d: symbol %s not found\n", m->id, name);
+    exit(1);
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Load a private instance of a mote library. The dynamic loader shares
+ * libraries opened twice under the same name, so every node opens its
+ * own temporary copy.
+ */
+static void
+mote_load(struct mote *m, const char *lib, const char *classname)
+{
+  char path[] = "/tmp/mobirpl-sim-XXXXXX";
+  char buf[8192];
+  char name[128];
+  void (*init)(void *env, void *obj);
+  FILE *in, *out;
+  size_t len;
+  int fd;
+
+  fd = mkstemp(path);
+  if(fd < 0) {
+    perror("mkstemp");
+    exit(1);
+  }
+  in = fopen(lib, "rb");
+  out = fdopen(fd, "wb");
+  if(in == NULL || out == NULL) {
+    perror(lib);
+    exit(1);
+  }
+  while((len = fread(buf, 1, sizeof(buf), in)) > 0) {
+    fwrite(buf, 1, len, out);
+  }
+  fclose(in);
+  fclose(out);
+
+  m->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  unlink(path);
+  if(m->handle == NULL) {
+    fprintf(stderr, "%s: %s\n", lib, dlerror());
+    exit(1);
+  }
+
+  snprintf(name, sizeof(name), JNI_PREFIX "%s_init", classname);
+  init = (void (*)(void *, void *))lookup(m, name);
+  snprintf(name, sizeof(name), JNI_PREFIX "%s_tick", classname);
+  m->tick = (void (*)(void *, void *))lookup(m, name);
+
+  m->sim_current_time = lookup(m, "simCurrentTime");
+  m->sim_process_run_value = lookup(m, "simProcessRunValue");
+  m->sim_etimer_pending = lookup(m, "simEtimerPending");
+  m->sim_next_expiration_time = lookup(m, "simNextExpirationTime");
+  m->sim_receiving = lookup(m, "simReceiving");
+  m->sim_in_data_buffer = lookup(m, "simInDataBuffer");
+  m->sim_in_size = lookup(m, "simInSize");
+  m->sim_out_data_buffer = lookup(m, "simOutDataBuffer");
+  m->sim_out_size = lookup(m, "simOutSize");
+  m->sim_radio_hw_on = lookup(m, "simRadioHWOn");
+  m->sim_signal_strength = lookup(m, "simSignalStrength");
+  m->sim_power = lookup(m, "simPower");
+  m->sim_radio_channel = lookup(m, "simRadioChannel");
+  m->sim_logged_data = lookup(m, "simLoggedData");
+  m->sim_logged_length = lookup(m, "simLoggedLength");
+  m->sim_logged_flag = lookup(m, "simLoggedFlag");
+
+  init(NULL, NULL);
+
+  /* ContikiMoteID */
+  *(int *)lookup(m, "simMoteID") = m->id;
+  *(int *)lookup(m, "simRandomSeed") = (int)(random_seed + m->id);
+  *(char *)lookup(m, "simMoteIDChanged") = 1;
+
+  m->radio_on = *m->sim_radio_hw_on == 1;
+  m->channel = *m->sim_radio_channel;
+}
+/*---------------------------------------------------------------------------*/
+static double
+distance(struct mote *a, struct mote *b)
+{
+  return hypot(a->x - b->x, a->y - b->y);
+}
+/*---------------------------------------------------------------------------*/
+static double
+output_ratio(struct mote *m)
+{
+  return (double)*m->sim_power / 100.0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+different_channels(struct mote *a, struct mote *b)
+{
+  return *a->sim_radio_channel >= 0 && *b->sim_radio_channel >= 0 &&
+    *a->sim_radio_channel != *b->sim_radio_channel;
+}
+/*---------------------------------------------------------------------------*/
+static void
+interfere_any_reception(struct mote *m)
+{
+  m->interfered = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+signal_reception_start(struct mote *m)
+{
+  m->has_rx_packet = 0;
+  if(m->interfered || *m->sim_receiving || m->transmitting) {
+    interfere_any_reception(m);
+    return;
+  }
+  *m->sim_receiving = 1;
+  schedule_wakeup(m, now);
+}
+/*---------------------------------------------------------------------------*/
+static void
+signal_reception_end(struct mote *m)
+{
+  if(m->interfered || !m->has_rx_packet) {
+    m->interfered = 0;
+    m->has_rx_packet = 0;
+    *m->sim_in_size = 0;
+  } else {
+    memcpy(m->sim_in_data_buffer, m->rx_packet, m->rx_len);
+    *m->sim_in_size = m->rx_len;
+  }
+  *m->sim_receiving = 0;
+  schedule_wakeup(m, now);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_interfered(struct connection *c, struct mote *m)
+{
+  c->flags[m->index] |= CONN_INTERFERED;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_destination(struct connection *c, struct mote *m)
+{
+  return (c->flags[m->index] & (CONN_DESTINATION | CONN_INTERFERED))
+    == CONN_DESTINATION;
+}
+/*---------------------------------------------------------------------------*/
+static struct connection *
+connection_from(struct mote *m)
+{
+  int i;
+
+  for(i = 0; i < nconnections; i++) {
+    if(connections[i].source == m) {
+      return &connections[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* UDGM.updateSignalStrengths() */
+static void
+update_signal_strengths(void)
+{
+  struct connection *c;
+  struct mote *src, *dst;
+  double ss, factor;
+  int i, j;
+
+  for(i = 0; i < nmotes; i++) {
+    *motes[i].sim_signal_strength = SS_NOTHING;
+  }
+
+  for(i = 0; i < nconnections; i++) {
+    c = &connections[i];
+    src = c->source;
+    if(*src->sim_signal_strength < SS_STRONG) {
+      *src->sim_signal_strength = SS_STRONG;
+    }
+    for(j = 0; j < nmotes; j++) {
+      dst = &motes[j];
+      if(!is_destination(c, dst) || different_channels(src, dst)) {
+        continue;
+      }
+      factor = distance(src, dst) / (tx_range * output_ratio(src));
+      ss = SS_STRONG + factor * (SS_WEAK - SS_STRONG);
+      if(*dst->sim_signal_strength < ss) {
+        *dst->sim_signal_strength = (int)ss;
+      }
+    }
+  }
+
+  for(i = 0; i < nconnections; i++) {
+    c = &connections[i];
+    src = c->source;
+    for(j = 0; j < nmotes; j++) {
+      dst = &motes[j];
+      if(!(c->flags[j] & CONN_INTERFERED) || different_channels(src, dst)) {
+        continue;
+      }
+      factor = distance(src, dst) / (tx_range * output_ratio(src));
+      if(factor < 1) {
+        ss = SS_STRONG + factor * (SS_WEAK - SS_STRONG);
+        if(*dst->sim_signal_strength < ss) {
+          *dst->sim_signal_strength = (int)ss;
+        }
+      } else {
+        *dst->sim_signal_strength = SS_WEAK;
+      }
+      interfere_any_reception(dst);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static double
+rx_success_probability(struct mote *src, struct mote *dst)
+{
+  double max, ratio;
+
+  max = tx_range * output_ratio(src);
+  if(max == 0.0) {
+    return 0.0;
+  }
+  ratio = pow(distance(src, dst), 2.0) / pow(max, 2.0);
+  if(ratio > 1.0) {
+    return 0.0;
+  }
+  return 1.0 - ratio * (1.0 - success_ratio_rx);
+}
+/*---------------------------------------------------------------------------*/
+/* UDGM.createConnections() */
+static void
+create_connection(struct connection *c, struct mote *src)
+{
+  struct mote *dst;
+  double range, irange, d;
+  int i, j;
+
+  c->source = src;
+  memset(c->flags, 0, nmotes);
+
+  if(success_ratio_tx < 1.0 && rng_double() > success_ratio_tx) {
+    return;
+  }
+
+  range = tx_range * output_ratio(src);
+  irange = interference_range * output_ratio(src);
+
+  for(i = 0; i < nmotes; i++) {
+    dst = &motes[i];
+    if(dst == src) {
+      continue;
+    }
+    if(different_channels(src, dst)) {
+      add_interfered(c, dst);
+      continue;
+    }
+    d = distance(src, dst);
+    if(d <= range) {
+      if(!dst->radio_on) {
+        add_interfered(c, dst);
+        interfere_any_reception(dst);
+      } else if(dst->interfered || dst->transmitting) {
+        add_interfered(c, dst);
+      } else if(*dst->sim_receiving ||
+                rng_double() > rx_success_probability(src, dst)) {
+        add_interfered(c, dst);
+        interfere_any_reception(dst);
+        for(j = 0; j < nconnections; j++) {
+          if(is_destination(&connections[j], dst)) {
+            add_interfered(&connections[j], dst);
+          }
+        }
+      } else {
+        c->flags[i] |= CONN_DESTINATION;
+      }
+    } else if(d <= irange) {
+      add_interfered(c, dst);
+      interfere_any_reception(dst);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+transmission_started(struct mote *src, int size)
+{
+  struct connection *c;
+  int i, j;
+
+  if(*src->sim_receiving) {
+    interfere_any_reception(src);
+    for(j = 0; j < nconnections; j++) {
+      if(is_destination(&connections[j], src)) {
+        add_interfered(&connections[j], src);
+      }
+    }
+  }
+
+  c = &connections[nconnections++];
+  create_connection(c, src);
+
+  for(i = 0; i < nmotes; i++) {
+    if(c->flags[i] & CONN_DESTINATION) {
+      signal_reception_start(&motes[i]);
+    }
+  }
+  update_signal_strengths();
+
+  /* The packet is delivered right away, reception ends with the transmission */
+  for(i = 0; i < nmotes; i++) {
+    if(c->flags[i] & CONN_DESTINATION) {
+      memcpy(motes[i].rx_packet, src->sim_out_data_buffer, size);
+      motes[i].rx_len = size;
+      motes[i].has_rx_packet = 1;
+    }
+  }
+  stat_tx++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+transmission_finished(struct mote *src)
+{
+  struct connection *c;
+  unsigned char *flags;
+  int i;
+
+  c = connection_from(src);
+  if(c == NULL) {
+    return;
+  }
+
+  /* Remove the connection but keep its flag buffer for reuse */
+  flags = c->flags;
+  *c = connections[--nconnections];
+  connections[nconnections].flags = flags;
+  c = &connections[nconnections];
+
+  for(i = 0; i < nmotes; i++) {
+    if(c->flags[i] & CONN_DESTINATION) {
+      if(is_destination(c, &motes[i])) {
+        stat_rx++;
+      }
+      signal_reception_end(&motes[i]);
+    } else if(c->flags[i] & CONN_INTERFERED) {
+      stat_interfered++;
+      if(motes[i].interfered) {
+        signal_reception_end(&motes[i]);
+      }
+    }
+  }
+  update_signal_strengths();
+}
+/*---------------------------------------------------------------------------*/
+static void
+radio_hw_off(struct mote *m)
+{
+  int i;
+
+  /* A radio turned off while sending ends its transmission */
+  if(connection_from(m) != NULL) {
+    transmission_finished(m);
+  }
+  for(i = 0; i < nconnections; i++) {
+    if(is_destination(&connections[i], m)) {
+      add_interfered(&connections[i], m);
+      interfere_any_reception(m);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* ContikiRadio.doActionsAfterTick() */
+static void
+radio_after_tick(struct mote *m)
+{
+  uint64_t duration;
+  int size;
+
+  if(m->radio_on != (*m->sim_radio_hw_on == 1)) {
+    m->radio_on = !m->radio_on;
+    if(m->radio_on) {
+      m->radio_on_since = now;
+    } else {
+      m->radio_on_time += now - m->radio_on_since;
+      *m->sim_receiving = 0;
+      *m->sim_in_size = 0;
+      *m->sim_out_size = 0;
+      m->transmitting = 0;
+      radio_hw_off(m);
+    }
+    update_signal_strengths();
+  }
+  if(m->channel != *m->sim_radio_channel) {
+    /* What the radio hears depends on the channel it is tuned to */
+    m->channel = *m->sim_radio_channel;
+    update_signal_strengths();
+  }
+  if(!m->radio_on) {
+    return;
+  }
+
+  if(m->transmitting && now >= m->tx_end) {
+    *m->sim_out_size = 0;
+    m->transmitting = 0;
+    schedule_wakeup(m, now);
+    transmission_finished(m);
+  }
+
+  size = *m->sim_out_size;
+  if(!m->transmitting && size > 0) {
+    if(size > RADIO_BUFSIZE) {
+      size = RADIO_BUFSIZE;
+    }
+    m->transmitting = 1;
+    duration = (MILLISECOND * 8 * size) / RADIO_TRANSMISSION_RATE_KBPS;
+    m->tx_end = now + (duration > 1 ? duration : 1);
+    transmission_started(m, size);
+  }
+
+  if(m->transmitting && m->tx_end > now) {
+    schedule_wakeup(m, m->tx_end);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* ContikiClock.doActionsAfterTick() */
+static void
+clock_after_tick(struct mote *m)
+{
+  if(*m->sim_process_run_value != 0) {
+    schedule_wakeup(m, now + MILLISECOND);
+    return;
+  }
+  if(*m->sim_etimer_pending == 0) {
+    return;
+  }
+  if((long)*m->sim_next_expiration_time <= 0) {
+    schedule_wakeup(m, now + MILLISECOND);
+    return;
+  }
+  schedule_wakeup(m, now + MILLISECOND * *m->sim_next_expiration_time);
+}
+/*---------------------------------------------------------------------------*/
+static int quiet;
+
+static void
+log_after_tick(struct mote *m)
+{
+  int i, len;
+  char c;
+
+  if(!*m->sim_logged_flag) {
+    return;
+  }
+  len = *m->sim_logged_length;
+  if(len > MAX_LOG_LENGTH) {
+    len = MAX_LOG_LENGTH;
+  }
+  for(i = 0; i < len; i++) {
+    c = m->sim_logged_data[i];
+    if(c == '\n' || m->line_len == MAX_LINE_LENGTH - 1) {
+      m->line[m->line_len] = '\0';
+      if(!quiet) {
+        printf("%llu:%d:%s\n",
+               (unsigned long long)(now / MILLISECOND), m->id, m->line);
+      }
+      m->line_len = 0;
+      if(c == '\n') {
+        continue;
+      }
+    }
+    m->line[m->line_len++] = c;
+  }
+  *m->sim_logged_length = 0;
+  *m->sim_logged_flag = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* ContikiMote.execute() */
+static void
+mote_execute(struct mote *m)
+{
+  int64_t t;
+
+  m->wakeup_scheduled = 0;
+
+  t = (int64_t)now + m->drift;
+  if(t < 0) {
+    schedule_wakeup(m, now - t);
+    return;
+  }
+  if(t > 0) {
+    *m->sim_current_time = (unsigned long)(t / MILLISECOND);
+  }
+
+  m->tick(NULL, NULL);
+  m->ticks++;
+
+  radio_after_tick(m);
+  clock_after_tick(m);
+  log_after_tick(m);
+}
+/*---------------------------------------------------------------------------*/
+/* Read the next trace entry, returns 0 at end of file */
+static int
+trace_read(struct event *e)
+{
+  char buf[256];
+  double time;
+
+  while(fgets(buf, sizeof(buf), trace) != NULL) {
+    trace_line++;
+    if(buf[0] == '#' || buf[0] == '\n' || buf[0] == '\r') {
+      continue;
+    }
+    if(sscanf(buf, "%d %lf %lf %lf", &e->index, &time, &e->x, &e->y) != 4 ||
+       time < 0) {
+      fprintf(stderr, "trace:%ld: malformed line\n", trace_line);
+      exit(1);
+    }
+    e->time = (uint64_t)llround(time * SECOND);
+    e->type = EVENT_MOVE;
+    return 1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+trace_schedule_next(void)
+{
+  struct event e;
+
+  memset(&e, 0, sizeof(e));
+  while(trace_read(&e)) {
+    if(e.index < 0 || e.index >= nmotes) {
+      /* Like the Mobility plugin: entries without a node are ignored */
+      continue;
+    }
+    if(e.time < now) {
+      fprintf(stderr, "trace:%ld: not sorted by time\n", trace_line);
+      exit(1);
+    }
+    event_push(&e);
+    return;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Count the nodes in a trace and apply all positions at time zero */
+static int
+trace_count_nodes(const char *file)
+{
+  struct event e;
+  int max;
+
+  trace = fopen(file, "r");
+  if(trace == NULL) {
+    perror(file);
+    exit(1);
+  }
+  max = -1;
+  while(trace_read(&e)) {
+    if(e.index > max) {
+      max = e.index;
+    }
+  }
+  rewind(trace);
+  trace_line = 0;
+  return max + 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint64_t
+trace_end_time(void)
+{
+  struct event e;
+  uint64_t end;
+
+  end = 0;
+  while(trace_read(&e)) {
+    if(e.time > end) {
+      end = e.time;
+    }
+  }
+  rewind(trace);
+  trace_line = 0;
+  return end;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  const char *sink_lib = NULL, *mote_lib = NULL, *trace_file = NULL;
+  const char *classname = "Lib1";
+  unsigned long seed = 123456;
+  uint64_t duration = 0;
+  unsigned long max_delay = 1000;
+  int sink_id = 1;
+  struct event e;
+  struct mote *m;
+  unsigned long ticks;
+  uint64_t radio_on_sum, radio_on_max;
+  int counted;
+  int c, i;
+
+  while((c = getopt(argc, argv, "s:m:t:n:k:d:r:R:I:T:X:D:c:q")) != -1) {
+    switch(c) {
+    case 's': sink_lib = optarg; break;
+    case 'm': mote_lib = optarg; break;
+    case 't': trace_file = optarg; break;
+    case 'n': nmotes = atoi(optarg); break;
+    case 'k': sink_id = atoi(optarg); break;
+    case 'd': duration = (uint64_t)(atof(optarg) * SECOND); break;
+    case 'r': seed = strtoul(optarg, NULL, 0); break;
+    case 'R': tx_range = atof(optarg); break;
+    case 'I': interference_range = atof(optarg); break;
+    case 'T': success_ratio_tx = atof(optarg); break;
+    case 'X': success_ratio_rx = atof(optarg); break;
+    case 'D': max_delay = strtoul(optarg, NULL, 0); break;
+    case 'c': classname = optarg; break;
+    case 'q': quiet = 1; break;
+    default: usage(argv[0]);
+    }
+  }
+  if(sink_lib == NULL || mote_lib == NULL || trace_file == NULL) {
+    usage(argv[0]);
+  }
+
+  random_seed = seed;
+  rng_state = seed ? seed : 1;
+
+  if(nmotes <= 0) {
+    nmotes = trace_count_nodes(trace_file);
+  } else {
+    trace_count_nodes(trace_file);
+  }
+  if(nmotes <= 0) {
+    fprintf(stderr, "%s: no nodes\n", trace_file);
+    return 1;
+  }
+  if(duration == 0) {
+    duration = trace_end_time();
+  }
+
+  motes = calloc(nmotes, sizeof(struct mote));
+  connections = calloc(nmotes, sizeof(struct connection));
+  for(i = 0; i < nmotes; i++) {
+    connections[i].flags = calloc(nmotes, 1);
+  }
+
+  /* Initial positions */
+  while(trace_read(&e) && e.time == 0) {
+    if(e.index >= 0 && e.index < nmotes) {
+      motes[e.index].x = e.x;
+      motes[e.index].y = e.y;
+    }
+  }
+  rewind(trace);
+  trace_line = 0;
+
+  for(i = 0; i < nmotes; i++) {
+    m = &motes[i];
+    m->index = i;
+    m->id = i + 1;
+    mote_load(m, m->id == sink_id ? sink_lib : mote_lib, classname);
+    /* Random startup delay, as with Cooja's mote startup delay */
+    m->drift = max_delay > 0 ?
+      -(int64_t)((rng_next() % max_delay) * MILLISECOND) : 0;
+    schedule_wakeup(m, 0);
+  }
+
+  trace_schedule_next();
+
+  while(event_pop(&e) && e.time <= duration) {
+    now = e.time;
+    if(e.type == EVENT_MOVE) {
+      motes[e.index].x = e.x;
+      motes[e.index].y = e.y;
+      trace_schedule_next();
+    } else {
+      m = &motes[e.index];
+      if(!m->wakeup_scheduled || m->wakeup_seq != e.seq) {
+        /* Superseded by an earlier wakeup */
+        continue;
+      }
+      mote_execute(m);
+    }
+  }
+
+  /* Radio duty cycle, as the Cooja PowerTracker reports it. The sink
+     is always on and left out. */
+  now = duration;
+  ticks = 0;
+  radio_on_sum = radio_on_max = 0;
+  counted = 0;
+  for(i = 0; i < nmotes; i++) {
+    m = &motes[i];
+    ticks += m->ticks;
+    if(m->id == sink_id) {
+      continue;
+    }
+    if(m->radio_on) {
+      m->radio_on_time += now - m->radio_on_since;
+    }
+    counted++;
+    radio_on_sum += m->radio_on_time;
+    if(m->radio_on_time > radio_on_max) {
+      radio_on_max = m->radio_on_time;
+    }
+  }
+  fprintf(stderr, "mobirpl-sim: %d nodes, %llu s, seed %lu: "
+          "%lu ticks, %lu tx, %lu rx, %lu interfered, "
+          "radio on %.2f%% avg %.2f%% max\n",
+          nmotes, (unsigned long long)(duration / SECOND), seed,
+          ticks, stat_tx, stat_rx, stat_interfered,
+          now > 0 && counted > 0 ? 100.0 * radio_on_sum / counted / now : 0,
+          now > 0 ? 100.0 * radio_on_max / now : 0);
+
+  fclose(trace);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/